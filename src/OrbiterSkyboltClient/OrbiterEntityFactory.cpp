@@ -150,6 +150,7 @@ sim::EntityPtr OrbiterEntityFactory::createPlanet(OBJHANDLE object) const
 			{"elevation", {
 				{"format", "orbiterElevation"},
 				{"url", planetTexturePath},
+				{"planetRadius", radius},
 				{"maxLevel", 13}, // TODO: determine correct maximum for tile source used
 				{"heightMapTexelsOnTileEdge", true}
 			}},
@@ -186,6 +187,7 @@ sim::EntityPtr OrbiterEntityFactory::createPlanet(OBJHANDLE object) const
 
 			planetJson["ocean"] = true;
 
+			// Skybolt's cloud layer only reads a single global map, so clouds can't be streamed from the planet's Cloud.tree
 			planetJson["clouds"] = {
 				{"map", "Environment/Cloud/cloud_combined_8192.png"}
 			};
@@ -20,9 +20,16 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include "OverlayPanelFactory.h"
 #include "SkyboltClient.h"
 #include "SkyboltParticleStream.h"
+#include "SurfaceLabels.h"
 #include "VideoTab.h"
+#include "TileSource/ElevationFilter.h"
+#include "TileSource/FeaturePlacementCache.h"
 #include "TileSource/OrbiterElevationTileSource.h"
 #include "TileSource/OrbiterImageTileSource.h"
+#include "TileSource/TileLoadShedder.h"
+#include "TileSource/UnbufferedFile.h"
+#include "TileSource/TileSourceStats.h"
+#include "TileSource/TileWorkerPool.h"
 
 #include <SkyboltEngine/EngineRoot.h>
 #include <SkyboltEngine/EngineRootFactory.h>
@@ -574,7 +581,21 @@ static nlohmann::json readSettings(const std::filesystem::path& filename)
 	"enabled": true,
 	"textureSize": 2048,
 	"cascadeBoundingDistances": [0.02, 2.0,  20.0, 130.0, 7000]
-}
+},
+"showSurfaceLabels": false,
+"validateTileArchives": false,
+"writeTileStats": false,
+"tileArchiveIo": "buffered",
+"terrainNormalMaps": false,
+"terrainSplitGeometricError": 0.0,
+"compactLandMask": false,
+"coScheduleSurfaceTiles": false,
+"landMaskCoverageIndex": false,
+"albedoMipmaps": false,
+"featurePlacement": false,
+"featurePlacementLevel": 14,
+"tileLoadShedding": false,
+"tileLoadSheddingMaxLatencyMs": 150
 })"_json;
 
 		BOOST_LOG_TRIVIAL(info) << "Creating settings file with defaults: " << filename.string();
@@ -631,13 +652,101 @@ HWND SkyboltClient::clbkCreateRenderWindow()
 		std::vector<PluginFactory> enginePluginFactories = {&skybolt::plugins::createFftOceanPlugin};
 		mEngineRoot = EngineRootFactory::create(enginePluginFactories, settings);
 
-		mEngineRoot->tileSourceFactoryRegistry->addFactory("orbiterElevation", [](const nlohmann::json& json) {
-			return std::make_shared<OrbiterElevationTileSource>(json.at("url"));
+		mTileSourceStats = std::make_unique<TileSourceStatsRegistry>();
+		mWriteTileSourceStats = settings.value("writeTileStats", false);
+
+		// Features are placed on tiles of this level, about 1.2 km wide on Earth
+		mFeaturePlacementEnabled = settings.value("featurePlacement", false);
+		mFeaturePlacementLevel = settings.value("featurePlacementLevel", 14);
+
+		// In unbuffered mode, archive reads bypass the OS page cache so that very large archives don't evict other data
+		std::shared_ptr<AlignedBufferPool> tileReadBufferPool;
+		if (settings.value("tileArchiveIo", "buffered") == "unbuffered")
+		{
+			constexpr std::size_t maxPooledBytes = 64 * 1024 * 1024;
+			tileReadBufferPool = std::make_shared<AlignedBufferPool>(unbufferedIoAlignment, maxPooledBytes);
+		}
+
+		// Under a tile loading backlog, such as in fast flight, the served tile level is temporarily capped so that loading catches up
+		std::shared_ptr<TileLoadShedder> tileLoadShedder;
+		if (settings.value("tileLoadShedding", false))
+		{
+			TileLoadSheddingConfig config;
+			config.maxLatencyMs = settings.value("tileLoadSheddingMaxLatencyMs", config.maxLatencyMs);
+			tileLoadShedder = std::make_shared<TileLoadShedder>(config);
+		}
+
+		// Tile sources are created after the render window, so the worker pools will exist by then
+		bool validateTileArchives = settings.value("validateTileArchives", false);
+		auto configureTileSource = [this, validateTileArchives, tileReadBufferPool, tileLoadShedder](std::shared_ptr<OrbiterTileSource> source) {
+			mTileSourceStats->add(source->getStats());
+			source->setLoadShedder(tileLoadShedder);
+			if (tileReadBufferPool)
+			{
+				source->enableUnbufferedIo(tileReadBufferPool);
+			}
+			if (validateTileArchives && mTileWorkerPool)
+			{
+				source->validateArchive(*mTileWorkerPool);
+			}
+			return source;
+		};
+
+		bool generateTerrainNormalMaps = settings.value("terrainNormalMaps", false);
+		double terrainSplitGeometricError = settings.value("terrainSplitGeometricError", 0.0); // meters
+		mEngineRoot->tileSourceFactoryRegistry->addFactory("orbiterElevation", [this, configureTileSource, generateTerrainNormalMaps, terrainSplitGeometricError](const nlohmann::json& json) {
+			auto source = std::make_shared<OrbiterElevationTileSource>(json.at("url"));
+			source->setMinSplitGeometricError(terrainSplitGeometricError);
+			source->setElevationFilters(getElevationFilters(json.at("url").get<std::string>()));
+			if (generateTerrainNormalMaps)
+			{
+				source->enableNormalMaps(json.at("planetRadius"));
+			}
+
+			PlanetTileSources& sources = mPlanetTileSources[json.at("url")];
+			sources.elevation = source;
+			sources.planetRadius = json.at("planetRadius");
+			return configureTileSource(source);
 		});
 
-		mEngineRoot->tileSourceFactoryRegistry->addFactory("orbiterImage", [](const nlohmann::json& json) {
+		// Image sources are shared per planet and layer, so that a planet's sources can find each other.
+		// Albedo and land mask sources of a planet are optionally co-scheduled, so that requesting a tile of either reads the other's tile ahead.
+		bool compactLandMask = settings.value("compactLandMask", false);
+		bool coScheduleSurfaceTiles = settings.value("coScheduleSurfaceTiles", false);
+		bool indexLandMaskCoverage = settings.value("landMaskCoverageIndex", false);
+		bool generateAlbedoMipmaps = settings.value("albedoMipmaps", false);
+		auto getImageTileSource = [this, configureTileSource, compactLandMask, coScheduleSurfaceTiles, indexLandMaskCoverage, generateAlbedoMipmaps](const std::string& url, OrbiterImageTileSource::LayerType layerType) {
+			PlanetTileSources& sources = mPlanetTileSources[url];
+			bool albedo = (layerType == OrbiterImageTileSource::LayerType::Albedo);
+			std::weak_ptr<OrbiterImageTileSource>& weakSource = albedo ? sources.albedo : sources.landMask;
+
+			std::shared_ptr<OrbiterImageTileSource> source = weakSource.lock();
+			if (!source)
+			{
+				source = std::make_shared<OrbiterImageTileSource>(url, layerType);
+				source->setCompactUniformLandMask(compactLandMask);
+				source->setGenerateMipmaps(albedo && generateAlbedoMipmaps);
+				if (indexLandMaskCoverage && mTileWorkerPool)
+				{
+					source->enableCoverageIndex(*mTileWorkerPool);
+				}
+				configureTileSource(source);
+				weakSource = source;
+
+				if (coScheduleSurfaceTiles && mTileWorkerPool)
+				{
+					if (std::shared_ptr<OrbiterImageTileSource> otherSource = (albedo ? sources.landMask : sources.albedo).lock(); otherSource)
+					{
+						OrbiterImageTileSource::coSchedule(source, otherSource, mTileWorkerPool);
+					}
+				}
+			}
+			return source;
+		};
+
+		mEngineRoot->tileSourceFactoryRegistry->addFactory("orbiterImage", [getImageTileSource](const nlohmann::json& json) {
 			auto layerType = (json.at("layerType") == "albedo") ? OrbiterImageTileSource::LayerType::Albedo : OrbiterImageTileSource::LayerType::LandMask;
-			return std::make_shared<OrbiterImageTileSource>(json.at("url"), layerType);
+			return getImageTileSource(json.at("url"), layerType);
 		});
 
 		auto textureProvider = [this](SURFHANDLE surface) {
@@ -711,6 +820,23 @@ HWND SkyboltClient::clbkCreateRenderWindow()
 		// Create NanoVG context for drawing HUD
 		m_nanoVgContext = CreateNanoVgContext();
 
+		mTileWorkerPool = std::make_shared<TileWorkerPool>(std::max(1, int(std::thread::hardware_concurrency()) / 2));
+
+		// Create surface labels
+		if (settings.value("showSurfaceLabels", false))
+		{
+			SurfaceLabelsConfig config;
+			config.camera = viewport->getFinalRenderTarget()->getOsgCamera();
+			config.nanoVgContext = m_nanoVgContext;
+			config.workerPool = mTileWorkerPool;
+			config.planetTexturePathProvider = [this](OBJHANDLE planet) {
+				char cbuf[256];
+				PlanetTexturePath(getName(planet).c_str(), cbuf);
+				return std::string(cbuf);
+			};
+			mSurfaceLabels = std::make_unique<SurfaceLabels>(config);
+		}
+
 		// Create HUD panel overlay
 		{
 			mPanelGroup = new osg::Group();
@@ -733,10 +859,107 @@ HWND SkyboltClient::clbkCreateRenderWindow()
 	}
 }
 
+void SkyboltClient::clbkCloseSession(bool fastclose)
+{
+	// Stats registry is recreated with the render window, so each file covers one session
+	if (mWriteTileSourceStats && mTileSourceStats)
+	{
+		file::Path filename = file::getAppUserDataDirectory("OrbiterSkybolt").append("TileStats.json");
+		BOOST_LOG_TRIVIAL(info) << "Writing tile statistics file: " << filename.string();
+		writeJsonFile(mTileSourceStats->toJson(), filename.string());
+	}
+}
+
+bool SkyboltClient::clbkFilterElevation(OBJHANDLE hPlanet, int ilat, int ilng, int lvl, double elev_res, INT16* elev)
+{
+	// Orbiter levels below the offset are global maps rather than quadtree tiles, so are never filtered
+	if (lvl < orbiterLevelZeroOffset)
+	{
+		return false;
+	}
+
+	std::shared_ptr<ElevationFilterChain> filters = getElevationFilters(hPlanet);
+	if (filters->isEmpty())
+	{
+		return false;
+	}
+
+	QuadTreeTileKey key;
+	key.level = lvl - orbiterLevelZeroOffset;
+	key.x = ilng;
+	key.y = ilat;
+
+	// Orbiter passes the same 259x259 grid, including padding, as stored in the elevation archive
+	ElevationFilterGrid grid;
+	grid.values = elev;
+	grid.width = 259;
+	grid.height = 259;
+	grid.scale = elev_res;
+	grid.offset = 0;
+	ElevationFilterChain::getTileBounds(key, grid);
+
+	return filters->apply(key, grid);
+}
+
+std::shared_ptr<ElevationFilterChain> SkyboltClient::getElevationFilters(OBJHANDLE planet)
+{
+	char cbuf[256];
+	PlanetTexturePath(getName(planet).c_str(), cbuf);
+	return getElevationFilters(std::string(cbuf));
+}
+
+std::shared_ptr<ElevationFilterChain> SkyboltClient::getElevationFilters(const std::string& planetTexturePath)
+{
+	std::scoped_lock<std::mutex> lock(mElevationFiltersMutex);
+	std::shared_ptr<ElevationFilterChain>& filters = mElevationFilters[planetTexturePath];
+	if (!filters)
+	{
+		filters = std::make_shared<ElevationFilterChain>();
+	}
+	return filters;
+}
+
+std::shared_ptr<FeaturePlacementCache> SkyboltClient::getFeaturePlacement(OBJHANDLE planet)
+{
+	if (!mFeaturePlacementEnabled || !mTileWorkerPool)
+	{
+		return nullptr;
+	}
+
+	char cbuf[256];
+	PlanetTexturePath(getName(planet).c_str(), cbuf);
+	auto i = mPlanetTileSources.find(std::string(cbuf));
+	if (i == mPlanetTileSources.end())
+	{
+		return nullptr;
+	}
+
+	PlanetTileSources& sources = i->second;
+	std::shared_ptr<FeaturePlacementCache> placement = sources.featurePlacement.lock();
+	if (!placement)
+	{
+		std::shared_ptr<OrbiterElevationTileSource> elevationSource = sources.elevation.lock();
+		std::shared_ptr<OrbiterImageTileSource> landMaskSource = sources.landMask.lock();
+		if (!elevationSource || !landMaskSource)
+		{
+			return nullptr;
+		}
+
+		FeaturePlacementConfig config;
+		config.level = mFeaturePlacementLevel;
+		config.planetRadius = sources.planetRadius;
+		placement = std::make_shared<FeaturePlacementCache>(config, landMaskSource, elevationSource, mTileWorkerPool);
+		sources.featurePlacement = placement;
+	}
+	return placement;
+}
+
 void SkyboltClient::clbkDestroyRenderWindow(bool fastclose)
 {
 	mWindow.reset();
 	mEntities.clear();
+	mSurfaceLabels.reset();
+	mTileWorkerPool.reset(); // Join worker threads here rather than on module unload, where it is illegal
 }
 
 sim::Matrix3 toSkyboltMatrix3(const MATRIX3& m)
@@ -1041,6 +1264,11 @@ void SkyboltClient::clbkRenderScene()
 		Render2DOverlay();
 	}
 
+	if (mSurfaceLabels)
+	{
+		mSurfaceLabels->update(oapiCameraProxyGbody(), osg::Vec2i(mWindow->getWidth(), mWindow->getHeight()));
+	}
+
 	// Render
 	mWindow->render();
 
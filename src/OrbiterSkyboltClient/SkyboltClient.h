@@ -24,12 +24,20 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include <memory>
 #include <map>
+#include <mutex>
 
+class ElevationFilterChain;
+class FeaturePlacementCache;
+class OrbiterElevationTileSource;
+class OrbiterImageTileSource;
 class OrbiterEntityFactory;
 class OrbiterModel;
 class OsgSketchpad;
 class OverlayPanelFactory;
 class SkyboltParticleStream;
+class SurfaceLabels;
+class TileSourceStatsRegistry;
+class TileWorkerPool;
 class VideoTab;
 
 namespace oapi {
@@ -73,7 +81,8 @@ public:
 
 	void clbkPreOpenPopup () override {}
 
-	bool clbkFilterElevation(OBJHANDLE hPlanet, int ilat, int ilng, int lvl, double elev_res, INT16* elev) override { return false; }
+	//! Applies the planet's elevation filters to Orbiter's elevation tiles, so that the collision surface matches the rendered terrain
+	bool clbkFilterElevation(OBJHANDLE hPlanet, int ilat, int ilng, int lvl, double elev_res, INT16* elev) override;
 
 	ParticleStream *clbkCreateParticleStream (PARTICLESTREAMSPEC *pss) override;
 
@@ -163,7 +172,7 @@ public:
 
 	void clbkPostCreation () override {}
 
-	void clbkCloseSession (bool fastclose) override {}
+	void clbkCloseSession (bool fastclose) override;
 
 	void clbkDestroyRenderWindow (bool fastclose) override;
 
@@ -177,7 +186,22 @@ public:
 
 	void clbkStoreMeshPersistent(MESHHANDLE hMesh, const char *fname) override {}
 
+	//! @returns loading statistics for tile sources created in the current session.
+	//! Must only be called while the render window exists.
+	const TileSourceStatsRegistry& getTileSourceStats() const { return *mTileSourceStats; }
+
+	//! @returns filters applied to the planet's elevation, both for rendering and for Orbiter's collision surface.
+	//! Add-ons can add filters here, for example to flatten terrain under bases.
+	//!@ThreadSafe
+	std::shared_ptr<ElevationFilterChain> getElevationFilters(OBJHANDLE planet);
+
+	//! @returns features such as trees placed on the planet's tiles, shared between callers while any caller holds it.
+	//! Returns null if feature placement is disabled, or the planet's elevation and land mask tile sources have not been created.
+	//! Must only be called while the render window exists.
+	std::shared_ptr<FeaturePlacementCache> getFeaturePlacement(OBJHANDLE planet);
+
 	private:
+		std::shared_ptr<ElevationFilterChain> getElevationFilters(const std::string& planetTexturePath);
 		void updateVirtualCockpitTextures(OrbiterModel& model) const;
 		void updateEntity(OBJHANDLE object, skybolt::sim::Entity& entity) const;
 		void translateEntities();
@@ -191,6 +215,25 @@ private:
 	skybolt::sim::EntityPtr mSimCamera;
 	std::unique_ptr<VideoTab> mVideoTab;
 	std::shared_ptr<struct NVGcontext> m_nanoVgContext;
+	std::shared_ptr<TileWorkerPool> mTileWorkerPool;
+	std::unique_ptr<SurfaceLabels> mSurfaceLabels;
+	std::unique_ptr<TileSourceStatsRegistry> mTileSourceStats;
+	bool mWriteTileSourceStats = false;
+	std::map<std::string, std::shared_ptr<ElevationFilterChain>> mElevationFilters; //!< Keyed by planet texture path
+	std::mutex mElevationFiltersMutex;
+
+	struct PlanetTileSources
+	{
+		std::weak_ptr<OrbiterImageTileSource> albedo;
+		std::weak_ptr<OrbiterImageTileSource> landMask;
+		std::weak_ptr<OrbiterElevationTileSource> elevation;
+		double planetRadius = 0;
+		std::weak_ptr<FeaturePlacementCache> featurePlacement;
+	};
+	std::map<std::string, PlanetTileSources> mPlanetTileSources; //!< Keyed by planet texture path
+
+	bool mFeaturePlacementEnabled = false;
+	int mFeaturePlacementLevel = 0;
 
 	osg::ref_ptr<osg::Group> mPanelGroup;
 	std::map<OBJHANDLE, skybolt::sim::EntityPtr> mEntities;
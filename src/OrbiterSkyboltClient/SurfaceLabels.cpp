@@ -0,0 +1,197 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "OpenGlContext.h"
+#include "SurfaceLabels.h"
+#include "TileSource/SurfaceLabelIndex.h"
+
+#include <OrbiterAPI.h>
+
+#include <osg/Drawable>
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+#include "ThirdParty/nanovg/nanovg.h"
+
+using namespace skybolt;
+
+struct ScreenLabel
+{
+	osg::Vec2f position;
+	const std::string* name;
+};
+
+//! Draws all labels for the frame as a single nanoVG batch
+class SurfaceLabelDrawable : public osg::Drawable
+{
+public:
+	SurfaceLabelDrawable(const std::shared_ptr<NVGcontext>& nvgContext) : m_nvgContext(nvgContext)
+	{
+		assert(m_nvgContext);
+		setUseDisplayList(false);
+		setCullingActive(false);
+	}
+
+	//! @param tiles keeps alive the tiles that own the label names
+	void setLabels(std::vector<SurfaceLabelTilePtr> tiles, std::vector<ScreenLabel> labels)
+	{
+		mTiles = std::move(tiles);
+		mLabels = std::move(labels);
+	}
+
+	void drawImplementation(osg::RenderInfo& renderInfo) const override
+	{
+		if (mLabels.empty())
+		{
+			return;
+		}
+
+		auto vg = m_nvgContext.get();
+
+		auto viewport = renderInfo.getCurrentCamera()->getViewport();
+		nvgBeginFrame(vg, viewport->width(), viewport->height(), /* pxRatio */ 1.0);
+
+		nvgFontSize(vg, 14);
+		nvgFontFace(vg, "Sans");
+		nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_BOTTOM);
+		nvgFillColor(vg, nvgRGBA(255, 255, 255, 255));
+
+		for (const ScreenLabel& label : mLabels)
+		{
+			nvgText(vg, label.position.x(), label.position.y(), label.name->c_str(), nullptr);
+		}
+
+		nvgEndFrame(vg);
+
+		// Cleanup OpenGL state after nanoVG
+		glDisable(GL_BLEND);
+	}
+
+private:
+	std::shared_ptr<NVGcontext> m_nvgContext;
+	std::vector<SurfaceLabelTilePtr> mTiles;
+	std::vector<ScreenLabel> mLabels;
+};
+
+SurfaceLabels::SurfaceLabels(const SurfaceLabelsConfig& config) :
+	mWorkerPool(config.workerPool),
+	mPlanetTexturePathProvider(config.planetTexturePathProvider)
+{
+	assert(config.camera);
+	assert(mWorkerPool);
+	assert(mPlanetTexturePathProvider);
+
+	mDrawable = new SurfaceLabelDrawable(config.nanoVgContext);
+	config.camera->addChild(mDrawable);
+}
+
+SurfaceLabels::~SurfaceLabels() = default;
+
+std::shared_ptr<SurfaceLabelIndex> SurfaceLabels::getOrCreateIndex(OBJHANDLE planet)
+{
+	auto i = mIndices.find(planet);
+	if (i == mIndices.end())
+	{
+		auto index = std::make_shared<SurfaceLabelIndex>(mPlanetTexturePathProvider(planet), mWorkerPool);
+		i = mIndices.insert({planet, index->isValid() ? index : nullptr}).first;
+	}
+	return i->second;
+}
+
+static constexpr int maxLabelLevel = 14;
+
+//! Number of tiles either side of the camera to show labels for at each level
+static constexpr double tileRadius = 2.0;
+
+//! Returns the keys of tiles around the camera's position on the planet.
+//! Coarse levels contribute labels over a wide area, and finer levels over a progressively smaller area.
+static std::vector<QuadTreeTileKey> getVisibleTileKeys(double latitude, double longitude, double altitude, double planetRadius)
+{
+	constexpr double pi = 3.14159265358979323846;
+	altitude = std::max(1.0, altitude);
+
+	// Show labels down to the level where tiles are about as wide as the camera is high
+	int maxLevel = std::clamp(int(std::log2(pi * planetRadius / altitude)), 0, maxLabelLevel);
+	double horizonAngle = std::acos(planetRadius / (planetRadius + altitude));
+
+	std::vector<QuadTreeTileKey> keys;
+	for (int level = 0; level <= maxLevel; ++level)
+	{
+		double tileSize = pi / double(1 << level);
+		double latRadius = std::min(horizonAngle, tileRadius * tileSize);
+		double lonRadius = latRadius / std::max(0.01, std::cos(std::min(pi / 2, std::abs(latitude) + latRadius)));
+		SurfaceLabelIndex::getTileKeysInBounds(level, latitude - latRadius, latitude + latRadius, longitude - lonRadius, longitude + lonRadius, keys);
+	}
+	return keys;
+}
+
+void SurfaceLabels::update(OBJHANDLE planet, const osg::Vec2i& viewportSize)
+{
+	std::shared_ptr<SurfaceLabelIndex> index = planet ? getOrCreateIndex(planet) : nullptr;
+	if (!index)
+	{
+		mDrawable->setLabels({}, {});
+		return;
+	}
+
+	VECTOR3 cameraPos;
+	oapiCameraGlobalPos(&cameraPos);
+	MATRIX3 cameraRotation;
+	oapiCameraRotationMatrix(&cameraRotation);
+
+	VECTOR3 planetPos;
+	oapiGetGlobalPos(planet, &planetPos);
+	double planetRadius = oapiGetSize(planet);
+
+	double cameraLongitude, cameraLatitude, cameraRadius;
+	oapiGlobalToEquatorial(planet, cameraPos, &cameraLongitude, &cameraLatitude, &cameraRadius);
+
+	std::vector<QuadTreeTileKey> keys = getVisibleTileKeys(cameraLatitude, cameraLongitude, cameraRadius - planetRadius, planetRadius);
+	std::vector<SurfaceLabelTilePtr> tiles;
+	index->query(keys, tiles);
+
+	double halfWidth = viewportSize.x() * 0.5;
+	double halfHeight = viewportSize.y() * 0.5;
+	double focalLength = halfHeight / std::tan(oapiCameraAperture());
+
+	std::vector<ScreenLabel> labels;
+	for (const SurfaceLabelTilePtr& tile : tiles)
+	{
+		for (const SurfaceLabel& label : tile->labels)
+		{
+			VECTOR3 labelPos;
+			oapiEquToGlobal(planet, label.longitude, label.latitude, planetRadius + label.altitude, &labelPos);
+
+			// Cull labels on the far side of the planet
+			if (dotp(labelPos - planetPos, cameraPos - labelPos) <= 0)
+			{
+				continue;
+			}
+
+			VECTOR3 cameraRelPos = tmul(cameraRotation, labelPos - cameraPos);
+			if (cameraRelPos.z <= 0)
+			{
+				continue;
+			}
+
+			osg::Vec2f screenPos(
+				float(halfWidth + cameraRelPos.x / cameraRelPos.z * focalLength),
+				float(halfHeight - cameraRelPos.y / cameraRelPos.z * focalLength));
+
+			if (screenPos.x() >= 0 && screenPos.y() >= 0 && screenPos.x() < viewportSize.x() && screenPos.y() < viewportSize.y())
+			{
+				labels.push_back({screenPos, &label.name});
+			}
+		}
+	}
+
+	mDrawable->setLabels(std::move(tiles), std::move(labels));
+}
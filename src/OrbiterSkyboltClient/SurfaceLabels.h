@@ -0,0 +1,53 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <osg/Camera>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+class SurfaceLabelIndex;
+class TileWorkerPool;
+struct NVGcontext;
+
+typedef void* OBJHANDLE;
+
+struct SurfaceLabelsConfig
+{
+	osg::ref_ptr<osg::Camera> camera; //!< Camera to draw labels with
+	std::shared_ptr<NVGcontext> nanoVgContext;
+	std::shared_ptr<TileWorkerPool> workerPool;
+	std::function<std::string(OBJHANDLE planet)> planetTexturePathProvider;
+};
+
+//! Draws place name labels from the planet's label archive over the scene
+class SurfaceLabels
+{
+public:
+	SurfaceLabels(const SurfaceLabelsConfig& config);
+	~SurfaceLabels();
+
+	//! Selects the labels to draw this frame. Labels in tiles which are still being parsed are drawn on later frames.
+	//! @param planet is the planet to draw labels for, or null to draw none
+	void update(OBJHANDLE planet, const osg::Vec2i& viewportSize);
+
+private:
+	std::shared_ptr<SurfaceLabelIndex> getOrCreateIndex(OBJHANDLE planet);
+
+private:
+	osg::ref_ptr<class SurfaceLabelDrawable> mDrawable;
+	std::shared_ptr<TileWorkerPool> mWorkerPool;
+	std::function<std::string(OBJHANDLE planet)> mPlanetTexturePathProvider;
+	std::map<OBJHANDLE, std::shared_ptr<SurfaceLabelIndex>> mIndices;
+};
@@ -117,6 +117,7 @@ ZTreeMgr::ZTreeMgr(const char *PlanetPath, Layer _layer)
 	strcpy(path, PlanetPath);
 	layer = _layer;
 	treef = 0;
+	archiveName[0] = '\0';
 	OpenArchive();
 }
 
@@ -133,9 +134,8 @@ ZTreeMgr::~ZTreeMgr()
 bool ZTreeMgr::OpenArchive()
 {
 	const char *name[6] = { "Surf", "Mask", "Elev", "Elev_mod", "Label", "Cloud" };
-	char fname[256];
-	sprintf (fname, "%s\\Archive\\%s.tree", path, name[layer]);
-	treef = fopen(fname, "rb");
+	sprintf (archiveName, "%s\\Archive\\%s.tree", path, name[layer]);
+	treef = fopen(archiveName, "rb");
 	if (!treef) return false;
 
 	TreeFileHeader tfh;
@@ -183,24 +183,49 @@ DWORD ZTreeMgr::Idx(int lvl, int ilat, int ilng) const
 
 DWORD ZTreeMgr::ReadData(DWORD idx, BYTE **outp)
 {
+	BYTE *zbuf;
+	DWORD zsize = ReadDeflatedData(idx, &zbuf);
+	if (!zsize) {
+		*outp = 0;
+		return 0;
+	}
+
+	DWORD ndata = InflateData(idx, zbuf, zsize, outp);
+	ReleaseData(zbuf);
+	return ndata;
+}
+
+// -----------------------------------------------------------------------
+
+DWORD ZTreeMgr::ReadDeflatedData(DWORD idx, BYTE **outp)
+{
+	*outp = 0;
 	if (idx == (DWORD)-1) return 0; // sanity check
 
-	DWORD esize = NodeSizeInflated(idx);
-	if (!esize) // node doesn't have data, but has descendants with data
+	if (!NodeSizeInflated(idx)) // node doesn't have data, but has descendants with data
 		return 0;
 
 	if (_fseeki64(treef, toc[idx].pos+dofs, SEEK_SET))
 		return 0;
 
 	DWORD zsize = NodeSizeDeflated(idx);
-	BYTE *zbuf = new BYTE[zsize];	
-	fread(zbuf, 1, zsize, treef);
+	BYTE *zbuf = new BYTE[zsize];
+	if (fread(zbuf, 1, zsize, treef) != zsize) {
+		delete []zbuf;
+		return 0;
+	}
+	*outp = zbuf;
+	return zsize;
+}
 
-	BYTE *ebuf = new BYTE[esize];
+// -----------------------------------------------------------------------
 
-	DWORD ndata = Inflate(zbuf, zsize, ebuf, esize);
-	delete []zbuf;
+DWORD ZTreeMgr::InflateData(DWORD idx, const BYTE *zbuf, DWORD zsize, BYTE **outp) const
+{
+	DWORD esize = NodeSizeInflated(idx);
+	BYTE *ebuf = new BYTE[esize];
 
+	DWORD ndata = InflateData(idx, zbuf, zsize, ebuf);
 	if (!ndata) {
 		delete []ebuf;
 		ebuf = 0;
@@ -211,7 +236,14 @@ DWORD ZTreeMgr::ReadData(DWORD idx, BYTE **outp)
 
 // -----------------------------------------------------------------------
 
-DWORD ZTreeMgr::Inflate(const BYTE *inp, DWORD ninp, BYTE *outp, DWORD noutp)
+DWORD ZTreeMgr::InflateData(DWORD idx, const BYTE *zbuf, DWORD zsize, BYTE *ebuf) const
+{
+	return Inflate(zbuf, zsize, ebuf, NodeSizeInflated(idx));
+}
+
+// -----------------------------------------------------------------------
+
+DWORD ZTreeMgr::Inflate(const BYTE *inp, DWORD ninp, BYTE *outp, DWORD noutp) const
 {
 	return oapiInflate(inp, ninp, outp, noutp);
 }
@@ -104,17 +104,32 @@ public:
 	inline DWORD ReadData(int lvl, int ilat, int ilng, BYTE **outp)
 	{ return ReadData(Idx(lvl, ilat, ilng), outp); }
 
+	// read the compressed data block of a node without inflating it (not thread-safe)
+	DWORD ReadDeflatedData(DWORD idx, BYTE **outp);
+
+	// inflate a block returned by ReadDeflatedData. Does not access the archive, so may be called concurrently.
+	DWORD InflateData(DWORD idx, const BYTE *zbuf, DWORD zsize, BYTE **outp) const;
+
+	// as above, but inflates into a caller supplied buffer of at least NodeSizeInflated(idx) bytes
+	DWORD InflateData(DWORD idx, const BYTE *zbuf, DWORD zsize, BYTE *ebuf) const;
+
 	void ReleaseData(BYTE *data);
 
 	inline DWORD NodeSizeDeflated(DWORD idx) const { return toc.NodeSizeDeflated(idx); }
 	inline DWORD NodeSizeInflated(DWORD idx) const { return toc.NodeSizeInflated(idx); }
 
+	// archive file name, and the file offset and length of the compressed data block
+	const char *ArchiveName() const { return archiveName; }
+	inline __int64 DataOffset() const { return dofs; }
+	inline __int64 DataLength() const { return toc.totlength; }
+
 protected:
 	bool OpenArchive();
-	DWORD Inflate(const BYTE *inp, DWORD ninp, BYTE *outp, DWORD noutp);
+	DWORD Inflate(const BYTE *inp, DWORD ninp, BYTE *outp, DWORD noutp) const;
 
 private:
 	char *path;
+	char archiveName[256];
 	Layer layer;
 	FILE *treef;
 	TreeTOC toc;
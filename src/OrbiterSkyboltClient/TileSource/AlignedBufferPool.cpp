@@ -0,0 +1,129 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "AlignedBufferPool.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <malloc.h>
+
+AlignedBufferPool::AlignedBufferPool(std::size_t alignment, std::size_t maxPooledBytes, CapacityRounding rounding) :
+	mAlignment(alignment),
+	mMaxPooledBytes(maxPooledBytes),
+	mRounding(rounding)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+}
+
+AlignedBufferPool::~AlignedBufferPool()
+{
+	for (const auto& [capacity, buffers] : mFreeBuffers)
+	{
+		for (std::uint8_t* data : buffers)
+		{
+			_aligned_free(data);
+		}
+	}
+}
+
+static std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+	std::size_t result = 1;
+	while (result < value)
+	{
+		result <<= 1;
+	}
+	return result;
+}
+
+AlignedBufferPool::Buffer AlignedBufferPool::acquire(std::size_t sizeBytes)
+{
+	std::size_t capacity = (mRounding == CapacityRounding::PowerOfTwo)
+		? roundUpToPowerOfTwo(std::max(sizeBytes, mAlignment))
+		: std::max(mAlignment, (sizeBytes + mAlignment - 1) & ~(mAlignment - 1));
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		if (auto i = mFreeBuffers.find(capacity); i != mFreeBuffers.end() && !i->second.empty())
+		{
+			std::uint8_t* data = i->second.back();
+			i->second.pop_back();
+			mPooledBytes -= capacity;
+			return Buffer(shared_from_this(), data, capacity);
+		}
+	}
+
+	auto data = static_cast<std::uint8_t*>(_aligned_malloc(capacity, mAlignment));
+	if (!data)
+	{
+		return Buffer();
+	}
+	return Buffer(shared_from_this(), data, capacity);
+}
+
+void AlignedBufferPool::release(std::uint8_t* data, std::size_t capacity)
+{
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		if (mPooledBytes + capacity <= mMaxPooledBytes)
+		{
+			mFreeBuffers[capacity].push_back(data);
+			mPooledBytes += capacity;
+			return;
+		}
+	}
+	_aligned_free(data);
+}
+
+AlignedBufferPool::Buffer::Buffer(std::shared_ptr<AlignedBufferPool> pool, std::uint8_t* data, std::size_t capacity) :
+	mPool(std::move(pool)),
+	mData(data),
+	mCapacity(capacity)
+{
+}
+
+AlignedBufferPool::Buffer::Buffer(Buffer&& other) noexcept :
+	mPool(std::move(other.mPool)),
+	mData(other.mData),
+	mCapacity(other.mCapacity)
+{
+	other.mData = nullptr;
+	other.mCapacity = 0;
+}
+
+AlignedBufferPool::Buffer& AlignedBufferPool::Buffer::operator=(Buffer&& other) noexcept
+{
+	if (this != &other)
+	{
+		reset();
+		mPool = std::move(other.mPool);
+		mData = other.mData;
+		mCapacity = other.mCapacity;
+		other.mData = nullptr;
+		other.mCapacity = 0;
+	}
+	return *this;
+}
+
+AlignedBufferPool::Buffer::~Buffer()
+{
+	reset();
+}
+
+void AlignedBufferPool::Buffer::reset()
+{
+	if (mData)
+	{
+		mPool->release(mData, mCapacity);
+		mData = nullptr;
+		mCapacity = 0;
+	}
+	mPool.reset();
+}
@@ -0,0 +1,76 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! Pool of reusable buffers with aligned addresses and sizes, as required for unbuffered I/O.
+class AlignedBufferPool : public std::enable_shared_from_this<AlignedBufferPool>
+{
+public:
+	enum class CapacityRounding
+	{
+		PowerOfTwo, //!< Buffers can be reused for similarly sized requests
+		Alignment //!< Buffers are only reused for requests of the same size after rounding, but waste less memory
+	};
+
+	//! @param alignment must be a power of two
+	//! @param maxPooledBytes is the maximum total capacity of idle buffers retained for reuse
+	AlignedBufferPool(std::size_t alignment, std::size_t maxPooledBytes, CapacityRounding rounding = CapacityRounding::PowerOfTwo);
+	~AlignedBufferPool();
+
+	//! Returns its memory to the pool on destruction
+	class Buffer
+	{
+	public:
+		Buffer() = default;
+		Buffer(Buffer&& other) noexcept;
+		Buffer& operator=(Buffer&& other) noexcept;
+		~Buffer();
+
+		std::uint8_t* data() const { return mData; }
+		std::size_t capacity() const { return mCapacity; }
+
+	private:
+		friend class AlignedBufferPool;
+		Buffer(std::shared_ptr<AlignedBufferPool> pool, std::uint8_t* data, std::size_t capacity);
+		void reset();
+
+		std::shared_ptr<AlignedBufferPool> mPool;
+		std::uint8_t* mData = nullptr;
+		std::size_t mCapacity = 0;
+	};
+
+	//! @returns a buffer of at least sizeBytes, or a buffer with null data if memory could not be allocated.
+	//! The pool must be owned by a shared_ptr.
+	//!@ThreadSafe
+	Buffer acquire(std::size_t sizeBytes);
+
+	std::size_t getAlignment() const { return mAlignment; }
+
+private:
+	void release(std::uint8_t* data, std::size_t capacity);
+
+private:
+	const std::size_t mAlignment;
+	const std::size_t mMaxPooledBytes;
+	const CapacityRounding mRounding;
+
+	std::mutex mMutex;
+	std::map<std::size_t, std::vector<std::uint8_t*>> mFreeBuffers; //!< Keyed by capacity
+	std::size_t mPooledBytes = 0;
+};
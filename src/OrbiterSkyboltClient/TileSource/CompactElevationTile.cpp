@@ -0,0 +1,125 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "CompactElevationTile.h"
+
+#include <assert.h>
+#include <algorithm>
+
+//! Delta8 marker for a texel which is stored in full in the escape list
+static constexpr std::int8_t deltaEscape = INT8_MIN;
+
+CompactElevationTile::CompactElevationTile(const std::uint16_t* texels, int width, int height, const ElevationTexelBounds& bounds) :
+	mWidth(width),
+	mHeight(height),
+	mBase(bounds.min)
+{
+	assert(!bounds.isEmpty());
+	const std::size_t count = std::size_t(width) * height;
+
+	if (bounds.min == bounds.max)
+	{
+		mEncoding = Encoding::Constant;
+	}
+	else if (bounds.max - bounds.min <= UINT8_MAX)
+	{
+		mEncoding = Encoding::Offset8;
+		mBytes.resize(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			mBytes[i] = std::uint8_t(texels[i] - mBase);
+		}
+	}
+	else
+	{
+		encodeDelta8(texels);
+
+		// Fall back to raw texels if too many deltas were escaped for delta encoding to save memory
+		if (mBytes.size() + mWords.size() * sizeof(std::uint16_t) >= count * sizeof(std::uint16_t))
+		{
+			mEncoding = Encoding::Raw16;
+			std::vector<std::uint8_t>().swap(mBytes);
+			mWords.assign(texels, texels + count);
+		}
+	}
+}
+
+void CompactElevationTile::encodeDelta8(const std::uint16_t* texels)
+{
+	mEncoding = Encoding::Delta8;
+	mBytes.resize(std::size_t(mWidth) * mHeight);
+
+	// Each texel is predicted from its left neighbour, or for the first column, from the texel above
+	std::uint16_t rowStartPrediction = 0;
+	for (int y = 0; y < mHeight; ++y)
+	{
+		const std::uint16_t* row = texels + y * mWidth;
+		std::uint8_t* outRow = mBytes.data() + y * mWidth;
+		std::uint16_t prediction = rowStartPrediction;
+		for (int x = 0; x < mWidth; ++x)
+		{
+			int delta = int(row[x]) - int(prediction);
+			if (delta > deltaEscape && delta <= INT8_MAX)
+			{
+				outRow[x] = std::uint8_t(std::int8_t(delta));
+			}
+			else
+			{
+				outRow[x] = std::uint8_t(deltaEscape);
+				mWords.push_back(row[x]);
+			}
+			prediction = row[x];
+		}
+		rowStartPrediction = row[0];
+	}
+	mWords.shrink_to_fit();
+}
+
+void CompactElevationTile::decode(std::uint16_t* out) const
+{
+	const std::size_t count = std::size_t(mWidth) * mHeight;
+	switch (mEncoding)
+	{
+		case Encoding::Constant:
+			std::fill(out, out + count, mBase);
+			break;
+		case Encoding::Offset8:
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				out[i] = std::uint16_t(mBase + mBytes[i]);
+			}
+			break;
+		case Encoding::Delta8:
+		{
+			const std::uint16_t* escaped = mWords.data();
+			std::uint16_t rowStartPrediction = 0;
+			for (int y = 0; y < mHeight; ++y)
+			{
+				const std::uint8_t* row = mBytes.data() + y * mWidth;
+				std::uint16_t* outRow = out + y * mWidth;
+				std::uint16_t prediction = rowStartPrediction;
+				for (int x = 0; x < mWidth; ++x)
+				{
+					std::int8_t delta = std::int8_t(row[x]);
+					prediction = (delta == deltaEscape) ? *escaped++ : std::uint16_t(prediction + delta);
+					outRow[x] = prediction;
+				}
+				rowStartPrediction = outRow[0];
+			}
+			break;
+		}
+		case Encoding::Raw16:
+			std::copy(mWords.begin(), mWords.end(), out);
+			break;
+		default:
+			assert(!"Should not get here");
+	}
+}
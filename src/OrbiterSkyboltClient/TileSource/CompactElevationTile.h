@@ -0,0 +1,60 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "ElevationKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Losslessly compressed grid of biased elevation texels, for keeping decoded tiles resident at low memory cost.
+//! The encoding is chosen per tile:
+//! - Constant: flat tiles, such as oceans, are stored as a single texel
+//! - Offset8: tiles spanning fewer than 256 texel values are stored as 8 bit offsets from the minimum
+//! - Delta8: other tiles are stored as 8 bit differences from the previous texel, with larger differences stored separately
+//! - Raw16: tiles which do not compress with the above are stored uncompressed
+class CompactElevationTile
+{
+public:
+	//! @param bounds must contain all texels
+	CompactElevationTile(const std::uint16_t* texels, int width, int height, const ElevationTexelBounds& bounds);
+
+	//! Writes width*height texels to out
+	void decode(std::uint16_t* out) const;
+
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+
+	std::size_t getSizeBytes() const { return sizeof(*this) + mBytes.capacity() + mWords.capacity() * sizeof(std::uint16_t); }
+
+	enum class Encoding
+	{
+		Constant,
+		Offset8,
+		Delta8,
+		Raw16
+	};
+
+	Encoding getEncoding() const { return mEncoding; }
+
+private:
+	void encodeDelta8(const std::uint16_t* texels);
+
+private:
+	int mWidth;
+	int mHeight;
+	Encoding mEncoding;
+	std::uint16_t mBase; //!< Constant value for Constant encoding, or minimum texel for Offset8 encoding
+	std::vector<std::uint8_t> mBytes; //!< Offsets or deltas
+	std::vector<std::uint16_t> mWords; //!< Texels for Raw16 encoding, or escaped texels for Delta8 encoding
+};
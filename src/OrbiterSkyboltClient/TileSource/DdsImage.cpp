@@ -0,0 +1,176 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "DdsImage.h"
+#include "DxtKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+#pragma pack(push,1)
+//! From Microsoft DDS file format documentation
+struct DdsPixelFormat
+{
+	std::uint32_t size;
+	std::uint32_t flags;
+	std::uint32_t fourCC;
+	std::uint32_t rgbBitCount;
+	std::uint32_t rBitMask;
+	std::uint32_t gBitMask;
+	std::uint32_t bBitMask;
+	std::uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+	std::uint32_t size;
+	std::uint32_t flags;
+	std::uint32_t height;
+	std::uint32_t width;
+	std::uint32_t pitchOrLinearSize;
+	std::uint32_t depth;
+	std::uint32_t mipMapCount;
+	std::uint32_t reserved1[11];
+	DdsPixelFormat pixelFormat;
+	std::uint32_t caps;
+	std::uint32_t caps2;
+	std::uint32_t caps3;
+	std::uint32_t caps4;
+	std::uint32_t reserved2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(DdsHeader) == 124, "DDS header size must match the file format");
+
+constexpr std::uint32_t makeFourCC(char a, char b, char c, char d)
+{
+	return std::uint32_t(std::uint8_t(a)) | (std::uint32_t(std::uint8_t(b)) << 8) | (std::uint32_t(std::uint8_t(c)) << 16) | (std::uint32_t(std::uint8_t(d)) << 24);
+}
+
+constexpr std::uint32_t ddsMagic = makeFourCC('D', 'D', 'S', ' ');
+constexpr std::uint32_t fourCCDxt1 = makeFourCC('D', 'X', 'T', '1');
+constexpr std::uint32_t ddsdMipMapCount = 0x20000;
+constexpr std::uint32_t ddsdDepth = 0x800000;
+constexpr std::uint32_t ddpfAlphaPixels = 0x1;
+constexpr std::uint32_t ddpfFourCC = 0x4;
+constexpr std::uint32_t ddsCaps2CubeMap = 0x200;
+constexpr std::uint32_t ddsCaps2Volume = 0x200000;
+
+constexpr std::size_t dataOffset = sizeof(std::uint32_t) + sizeof(DdsHeader);
+
+//! Image which keeps its data in a pooled buffer, returning the buffer to the pool on destruction
+class PooledBufferImage : public osg::Image
+{
+public:
+	PooledBufferImage(AlignedBufferPool::Buffer buffer) : mBuffer(std::move(buffer)) {}
+
+	std::uint8_t* getBufferData() const { return mBuffer.data(); }
+	std::size_t getBufferCapacity() const { return mBuffer.capacity(); }
+
+protected:
+	// The base class destructor runs after the buffer is returned, so image data must be set with NO_DELETE
+	~PooledBufferImage() override = default;
+
+private:
+	AlignedBufferPool::Buffer mBuffer;
+};
+
+} // namespace
+
+std::optional<Dxt1DdsLayout> getDxt1DdsLayout(const std::uint8_t* data, std::size_t sizeBytes)
+{
+	if (sizeBytes < dataOffset)
+	{
+		return std::nullopt;
+	}
+
+	std::uint32_t magic;
+	DdsHeader header;
+	std::memcpy(&magic, data, sizeof(magic));
+	std::memcpy(&header, data + sizeof(magic), sizeof(header));
+
+	if (magic != ddsMagic || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+	{
+		return std::nullopt;
+	}
+	if (!(header.pixelFormat.flags & ddpfFourCC) || header.pixelFormat.fourCC != fourCCDxt1)
+	{
+		return std::nullopt;
+	}
+	if (((header.flags & ddsdMipMapCount) && header.mipMapCount > 1) || ((header.flags & ddsdDepth) && header.depth > 1)
+		|| (header.caps2 & (ddsCaps2CubeMap | ddsCaps2Volume)))
+	{
+		return std::nullopt;
+	}
+	if (header.width == 0 || header.height == 0)
+	{
+		return std::nullopt;
+	}
+
+	std::size_t dataSize = std::size_t((header.width + 3) / 4) * ((header.height + 3) / 4) * dxt1BlockSizeBytes;
+	if (sizeBytes < dataOffset + dataSize)
+	{
+		return std::nullopt;
+	}
+
+	Dxt1DdsLayout layout;
+	layout.width = int(header.width);
+	layout.height = int(header.height);
+	layout.hasAlpha = (header.pixelFormat.flags & ddpfAlphaPixels) != 0;
+	layout.dataOffset = dataOffset;
+	return layout;
+}
+
+osg::ref_ptr<osg::Image> wrapDxt1DdsImage(AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes)
+{
+	std::optional<Dxt1DdsLayout> layout = getDxt1DdsLayout(buffer.data(), sizeBytes);
+	if (!layout)
+	{
+		return nullptr;
+	}
+
+	// Match the format chosen by the osgDB DDS reader
+	GLenum format = layout->hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	osg::ref_ptr<PooledBufferImage> image = new PooledBufferImage(std::move(buffer));
+	image->setImage(layout->width, layout->height, 1, format, format, GL_UNSIGNED_BYTE, image->getBufferData() + layout->dataOffset, osg::Image::NO_DELETE);
+	return image;
+}
+
+std::size_t getWrappedDxt1ImageCapacity(const osg::Image& image)
+{
+	auto pooledImage = dynamic_cast<const PooledBufferImage*>(&image);
+	if (!pooledImage)
+	{
+		return 0;
+	}
+	return pooledImage->getBufferCapacity() - std::size_t(image.data() - pooledImage->getBufferData());
+}
+
+std::optional<std::size_t> getSquareDxt1DdsSizeWithMipChain(std::size_t sizeBytes)
+{
+	if (sizeBytes <= dataOffset || (sizeBytes - dataOffset) % dxt1BlockSizeBytes != 0)
+	{
+		return std::nullopt;
+	}
+
+	std::size_t blockCount = (sizeBytes - dataOffset) / dxt1BlockSizeBytes;
+	std::size_t blockCountX = std::size_t(std::lround(std::sqrt(double(blockCount))));
+	if (blockCountX * blockCountX != blockCount)
+	{
+		return std::nullopt;
+	}
+
+	int width = int(blockCountX * 4);
+	return sizeBytes + getDxt1MipChainSizeBytes(width, width) - getDxt1ImageSizeBytes(width, width);
+}
@@ -0,0 +1,42 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "AlignedBufferPool.h"
+
+#include <osg/Image>
+
+#include <optional>
+
+struct Dxt1DdsLayout
+{
+	int width;
+	int height;
+	bool hasAlpha;
+	std::size_t dataOffset; //!< Offset of the DXT1 blocks from the start of the DDS data
+};
+
+//! @returns layout of DDS data if it is a single level 2D DXT1 image, otherwise nullopt
+std::optional<Dxt1DdsLayout> getDxt1DdsLayout(const std::uint8_t* data, std::size_t sizeBytes);
+
+//! Wraps DDS data as an osg::Image without copying, for the single level DXT1 images found in Orbiter tile archives.
+//! The image takes ownership of the buffer, returning it to its pool when the image is destroyed.
+//! @returns null if the data is not a single level 2D DXT1 image, in which case the buffer is left unchanged
+osg::ref_ptr<osg::Image> wrapDxt1DdsImage(AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes);
+
+//! @returns bytes of the wrapped buffer from the start of the image data to the end of the buffer,
+//! or 0 if the image was not created by wrapDxt1DdsImage()
+std::size_t getWrappedDxt1ImageCapacity(const osg::Image& image);
+
+//! @returns size of single level DDS data of the given size with a full mip chain appended after the base level,
+//! or nullopt if the size does not match a square DXT1 image. Used to size buffers before the DDS header can be read.
+std::optional<std::size_t> getSquareDxt1DdsSizeWithMipChain(std::size_t sizeBytes);
@@ -0,0 +1,385 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "DxtKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define DXT_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// A DXT1 block has two 16 bit endpoint colors, followed by four bytes of 2 bit texel indices, one byte per texel row from top to bottom.
+
+static void flipBlock(const std::uint8_t* block, std::uint8_t* out)
+{
+	std::uint8_t flipped[dxt1BlockSizeBytes] = {
+		block[0], block[1], block[2], block[3],
+		block[7], block[6], block[5], block[4]
+	};
+	std::memcpy(out, flipped, dxt1BlockSizeBytes);
+}
+
+//! Swaps two rows of blocks, flipping each block. Rows may be the same.
+static void swapAndFlipBlockRowsScalar(std::uint8_t* a, std::uint8_t* b, int blockCount)
+{
+	for (int i = 0; i < blockCount; ++i)
+	{
+		std::uint8_t* blockA = a + i * dxt1BlockSizeBytes;
+		std::uint8_t* blockB = b + i * dxt1BlockSizeBytes;
+		std::uint8_t flippedA[dxt1BlockSizeBytes];
+		flipBlock(blockA, flippedA);
+		flipBlock(blockB, blockA);
+		std::memcpy(blockB, flippedA, dxt1BlockSizeBytes);
+	}
+}
+
+template <typename SwapAndFlipRowsFn>
+static void flipDxt1Vertical(std::uint8_t* data, int width, int height, SwapAndFlipRowsFn swapAndFlipRows)
+{
+	assert(width % 4 == 0 && height % 4 == 0);
+	const int blockCountX = width / 4;
+	const int blockRowCount = height / 4;
+	const std::size_t rowSizeBytes = std::size_t(blockCountX) * dxt1BlockSizeBytes;
+
+	for (int top = 0, bottom = blockRowCount - 1; top <= bottom; ++top, --bottom)
+	{
+		swapAndFlipRows(data + top * rowSizeBytes, data + bottom * rowSizeBytes, blockCountX);
+	}
+}
+
+void flipDxt1VerticalScalar(std::uint8_t* data, int width, int height)
+{
+	flipDxt1Vertical(data, width, height, swapAndFlipBlockRowsScalar);
+}
+
+std::uint16_t getDxt1BlockTransparencyMask(const std::uint8_t* block)
+{
+	// Blocks only have transparent texels in three color mode, where the first endpoint is not greater than the second
+	std::uint16_t color0 = std::uint16_t(block[0] | (block[1] << 8));
+	std::uint16_t color1 = std::uint16_t(block[2] | (block[3] << 8));
+	if (color0 > color1)
+	{
+		return 0;
+	}
+
+	// Texels with index 3 are transparent. Gather the high and low bit of each index, then pack the four results of each row into a nibble.
+	std::uint16_t mask = 0;
+	for (int row = 0; row < 4; ++row)
+	{
+		int indices = block[4 + row];
+		int transparent = indices & (indices >> 1) & 0x55;
+		int packed = (transparent & 1) | ((transparent >> 1) & 2) | ((transparent >> 2) & 4) | ((transparent >> 3) & 8);
+		mask |= std::uint16_t(packed << (row * 4));
+	}
+	return mask;
+}
+
+int getDxt1MipLevelCount(int width, int height)
+{
+	int count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		++count;
+	}
+	return count;
+}
+
+std::size_t getDxt1ImageSizeBytes(int width, int height)
+{
+	return std::size_t((width + 3) / 4) * ((height + 3) / 4) * dxt1BlockSizeBytes;
+}
+
+std::size_t getDxt1MipChainSizeBytes(int width, int height)
+{
+	std::size_t sizeBytes = getDxt1ImageSizeBytes(width, height);
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		sizeBytes += getDxt1ImageSizeBytes(width, height);
+	}
+	return sizeBytes;
+}
+
+namespace {
+
+using Texel = std::array<int, 3>; //!< 8 bit RGB
+
+Texel decodeColor565(std::uint16_t color)
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+std::uint16_t encodeColor565(float r, float g, float b)
+{
+	auto quantize = [](float value, int maxValue) {
+		return std::clamp(int(value * maxValue / 255.0f + 0.5f), 0, maxValue);
+	};
+	return std::uint16_t((quantize(r, 31) << 11) | (quantize(g, 63) << 5) | quantize(b, 31));
+}
+
+std::array<Texel, 4> getPalette(std::uint16_t color0, std::uint16_t color1)
+{
+	std::array<Texel, 4> palette;
+	palette[0] = decodeColor565(color0);
+	palette[1] = decodeColor565(color1);
+	for (int c = 0; c < 3; ++c)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0; // transparent black
+		}
+	}
+	return palette;
+}
+
+//! Decodes a block's texels in row major order
+void decodeBlock(const std::uint8_t* block, Texel* texels)
+{
+	std::uint16_t color0 = std::uint16_t(block[0] | (block[1] << 8));
+	std::uint16_t color1 = std::uint16_t(block[2] | (block[3] << 8));
+	std::array<Texel, 4> palette = getPalette(color0, color1);
+
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			texels[row * 4 + column] = palette[(block[4 + row] >> (column * 2)) & 3];
+		}
+	}
+}
+
+//! Encodes texels in row major order as an opaque four color block.
+//! Endpoints are the extremes of the texels along their principal axis.
+void encodeBlock(const Texel* texels, std::uint8_t* block)
+{
+	float mean[3] = {0, 0, 0};
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			mean[c] += texels[i][c];
+		}
+	}
+	for (float& m : mean)
+	{
+		m /= 16.0f;
+	}
+
+	float covariance[3][3] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+		for (int a = 0; a < 3; ++a)
+		{
+			for (int b = 0; b < 3; ++b)
+			{
+				covariance[a][b] += d[a] * d[b];
+			}
+		}
+	}
+
+	// Find the principal axis by power iteration
+	float axis[3] = {1, 1, 1};
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[3];
+		for (int a = 0; a < 3; ++a)
+		{
+			next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+		}
+		float length = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+		if (length < 1e-6f)
+		{
+			break; // texels are all the same color
+		}
+		for (int a = 0; a < 3; ++a)
+		{
+			axis[a] = next[a] / length;
+		}
+	}
+
+	float minT = 0;
+	float maxT = 0;
+	float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	for (int i = 0; i < 16; ++i)
+	{
+		float t = ((texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2]) / axisLengthSq;
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	std::uint16_t color0 = encodeColor565(mean[0] + axis[0] * maxT, mean[1] + axis[1] * maxT, mean[2] + axis[2] * maxT);
+	std::uint16_t color1 = encodeColor565(mean[0] + axis[0] * minT, mean[1] + axis[1] * minT, mean[2] + axis[2] * minT);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	block[0] = std::uint8_t(color0);
+	block[1] = std::uint8_t(color0 >> 8);
+	block[2] = std::uint8_t(color1);
+	block[3] = std::uint8_t(color1 >> 8);
+
+	// Equal endpoints select three color mode, where only indices 0 to 2 are opaque, so all texels use index 0
+	if (color0 == color1)
+	{
+		std::memset(block + 4, 0, 4);
+		return;
+	}
+
+	std::array<Texel, 4> palette = getPalette(color0, color1);
+	for (int row = 0; row < 4; ++row)
+	{
+		std::uint8_t indices = 0;
+		for (int column = 0; column < 4; ++column)
+		{
+			const Texel& texel = texels[row * 4 + column];
+			int bestIndex = 0;
+			int bestDistance = INT_MAX;
+			for (int p = 0; p < 4; ++p)
+			{
+				int dr = texel[0] - palette[p][0];
+				int dg = texel[1] - palette[p][1];
+				int db = texel[2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= std::uint8_t(bestIndex << (column * 2));
+		}
+		block[4 + row] = indices;
+	}
+}
+
+} // namespace
+
+void downsampleDxt1(const std::uint8_t* src, int width, int height, std::uint8_t* dst)
+{
+	const int dstWidth = std::max(1, width / 2);
+	const int dstHeight = std::max(1, height / 2);
+	const int srcBlockCountX = (width + 3) / 4;
+	const int srcBlockCountY = (height + 3) / 4;
+	const int dstBlockCountX = (dstWidth + 3) / 4;
+	const int dstBlockCountY = (dstHeight + 3) / 4;
+
+	for (int dby = 0; dby < dstBlockCountY; ++dby)
+	{
+		for (int dbx = 0; dbx < dstBlockCountX; ++dbx)
+		{
+			// Decode the 2x2 source blocks covering the destination block into 8x8 texels
+			Texel source[64];
+			for (int sy = 0; sy < 2; ++sy)
+			{
+				for (int sx = 0; sx < 2; ++sx)
+				{
+					int sbx = std::min(dbx * 2 + sx, srcBlockCountX - 1);
+					int sby = std::min(dby * 2 + sy, srcBlockCountY - 1);
+					Texel decoded[16];
+					decodeBlock(src + (sby * srcBlockCountX + sbx) * dxt1BlockSizeBytes, decoded);
+					for (int row = 0; row < 4; ++row)
+					{
+						std::copy(decoded + row * 4, decoded + row * 4 + 4, source + (sy * 4 + row) * 8 + sx * 4);
+					}
+				}
+			}
+
+			// Box filter each destination texel from its 2x2 source texels. Texels beyond the edges of small
+			// levels are filled by clamping, so that they do not affect the block's endpoints.
+			Texel filtered[16];
+			for (int y = 0; y < 4; ++y)
+			{
+				int gy = std::min(dby * 4 + y, dstHeight - 1);
+				int y0 = gy * 2 - dby * 8;
+				int y1 = std::min(gy * 2 + 1, height - 1) - dby * 8;
+				for (int x = 0; x < 4; ++x)
+				{
+					int gx = std::min(dbx * 4 + x, dstWidth - 1);
+					int x0 = gx * 2 - dbx * 8;
+					int x1 = std::min(gx * 2 + 1, width - 1) - dbx * 8;
+					for (int c = 0; c < 3; ++c)
+					{
+						filtered[y * 4 + x][c] = (source[y0 * 8 + x0][c] + source[y0 * 8 + x1][c] + source[y1 * 8 + x0][c] + source[y1 * 8 + x1][c] + 2) / 4;
+					}
+				}
+			}
+
+			encodeBlock(filtered, dst + (dby * dstBlockCountX + dbx) * dxt1BlockSizeBytes);
+		}
+	}
+}
+
+#ifdef DXT_KERNELS_SSE2
+
+//! Reverses the bytes of the odd 32 bit lanes, which hold the texel indices of two blocks
+static __m128i flipBlocks2(__m128i blocks)
+{
+	const __m128i indexLanes = _mm_set_epi32(-1, 0, -1, 0);
+	const __m128i byte1 = _mm_set1_epi32(0x0000FF00);
+	const __m128i byte2 = _mm_set1_epi32(0x00FF0000);
+
+	__m128i reversed = _mm_or_si128(
+		_mm_or_si128(_mm_slli_epi32(blocks, 24), _mm_srli_epi32(blocks, 24)),
+		_mm_or_si128(_mm_and_si128(_mm_slli_epi32(blocks, 8), byte2), _mm_and_si128(_mm_srli_epi32(blocks, 8), byte1)));
+
+	return _mm_or_si128(_mm_and_si128(indexLanes, reversed), _mm_andnot_si128(indexLanes, blocks));
+}
+
+static void swapAndFlipBlockRowsSse2(std::uint8_t* a, std::uint8_t* b, int blockCount)
+{
+	// Both loads happen before the stores, so rows may be the same
+	int i = 0;
+	for (; i + 2 <= blockCount; i += 2)
+	{
+		__m128i* blocksA = reinterpret_cast<__m128i*>(a + i * dxt1BlockSizeBytes);
+		__m128i* blocksB = reinterpret_cast<__m128i*>(b + i * dxt1BlockSizeBytes);
+		__m128i valueA = _mm_loadu_si128(blocksA);
+		__m128i valueB = _mm_loadu_si128(blocksB);
+		_mm_storeu_si128(blocksA, flipBlocks2(valueB));
+		_mm_storeu_si128(blocksB, flipBlocks2(valueA));
+	}
+	swapAndFlipBlockRowsScalar(a + i * dxt1BlockSizeBytes, b + i * dxt1BlockSizeBytes, blockCount - i);
+}
+
+void flipDxt1Vertical(std::uint8_t* data, int width, int height)
+{
+	flipDxt1Vertical(data, width, height, swapAndFlipBlockRowsSse2);
+}
+
+#else
+
+void flipDxt1Vertical(std::uint8_t* data, int width, int height)
+{
+	flipDxt1VerticalScalar(data, width, height);
+}
+
+#endif // DXT_KERNELS_SSE2
@@ -0,0 +1,48 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//! Kernels operating on DXT1 (BC1) compressed image data, without decompressing whole images.
+//! Where noted, kernels are vectorized with SSE2 where available, falling back to scalar code otherwise. All implementations produce identical results.
+
+//! Size of a DXT1 block, which encodes 4x4 texels
+constexpr int dxt1BlockSizeBytes = 8;
+
+//! Flips DXT1 image data vertically in place, equivalent to decompressing, flipping and recompressing without loss.
+//! Block rows are reversed, and each block's rows of texel indices are reversed. Vectorized.
+//! @param width and height are in texels and must be multiples of 4, otherwise partially filled blocks would move to the wrong edge.
+void flipDxt1Vertical(std::uint8_t* data, int width, int height);
+
+//! Scalar reference implementation
+void flipDxt1VerticalScalar(std::uint8_t* data, int width, int height);
+
+//! @returns mask of texels in a DXT1 block with zero alpha, where bit (row * 4 + column) is set for each such texel.
+//! Rows are in the order stored in the block.
+std::uint16_t getDxt1BlockTransparencyMask(const std::uint8_t* block);
+
+//! @returns number of mip levels down to 1x1 texels, including the base level
+int getDxt1MipLevelCount(int width, int height);
+
+//! @returns size of a DXT1 image level, in which partially filled blocks take a whole block
+std::size_t getDxt1ImageSizeBytes(int width, int height);
+
+//! @returns total size of all levels of a DXT1 mip chain, including the base level, stored one after another
+std::size_t getDxt1MipChainSizeBytes(int width, int height);
+
+//! Generates the next mip level of DXT1 image data, halving each dimension down to a minimum of 1.
+//! Each destination block is made by decoding the 2x2 source blocks it covers, box filtering, and re-encoding.
+//! Transparent texels are treated as black, and the result is opaque.
+//! @param dst must hold getDxt1ImageSizeBytes() of the destination level
+void downsampleDxt1(const std::uint8_t* src, int width, int height, std::uint8_t* dst);
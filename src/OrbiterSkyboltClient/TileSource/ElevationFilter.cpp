@@ -0,0 +1,54 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "ElevationFilter.h"
+
+using namespace skybolt;
+
+constexpr double pi = 3.14159265358979323846;
+
+void ElevationFilterChain::add(ElevationFilter filter)
+{
+	std::scoped_lock<std::mutex> lock(mMutex);
+	mFilters.push_back(std::make_shared<const ElevationFilter>(std::move(filter)));
+}
+
+bool ElevationFilterChain::isEmpty() const
+{
+	std::scoped_lock<std::mutex> lock(mMutex);
+	return mFilters.empty();
+}
+
+bool ElevationFilterChain::apply(const QuadTreeTileKey& key, ElevationFilterGrid& grid) const
+{
+	// Run filters outside of the lock, so that tiles can be filtered concurrently
+	std::vector<std::shared_ptr<const ElevationFilter>> filters;
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		filters = mFilters;
+	}
+
+	bool modified = false;
+	for (const auto& filter : filters)
+	{
+		modified |= (*filter)(key, grid);
+	}
+	return modified;
+}
+
+void ElevationFilterChain::getTileBounds(const QuadTreeTileKey& key, ElevationFilterGrid& grid)
+{
+	const double tileSize = pi / (1 << key.level);
+	grid.north = pi / 2 - key.y * tileSize;
+	grid.south = grid.north - tileSize;
+	grid.west = key.x * tileSize - pi;
+	grid.east = grid.west + tileSize;
+}
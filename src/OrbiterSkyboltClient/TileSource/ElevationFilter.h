@@ -0,0 +1,68 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <SkyboltCommon/Math/QuadTree.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! Elevation grid of a tile, passed to elevation filters for modification in place
+struct ElevationFilterGrid
+{
+	std::int16_t* values; //!< Rows run from south to north. Elevation in meters = value * scale + offset.
+	int width; //!< Includes one texel of padding on each side, which lies in adjacent tiles
+	int height; //!< Includes one texel of padding on each side, which lies in adjacent tiles
+	double scale;
+	double offset;
+
+	//! Bounds of the grid excluding padding, in radians
+	double south;
+	double north;
+	double west;
+	double east;
+};
+
+//! Modifies a tile's elevation, for example to flatten terrain under a base.
+//! Runs on tile decode threads, so must be thread safe.
+//! @param key is the skybolt key of the tile
+//! @returns true if the grid was modified
+using ElevationFilter = std::function<bool(const skybolt::QuadTreeTileKey& key, ElevationFilterGrid& grid)>;
+
+//! Filters applied in order to a planet's elevation tiles.
+//! The same filters are applied to tiles for rendering and to Orbiter's collision surface, so that the two agree.
+//! Filtered tiles are cached by the tile source, so filters should be added before the planet's tiles are loaded.
+class ElevationFilterChain
+{
+public:
+	//!@ThreadSafe
+	void add(ElevationFilter filter);
+
+	//!@ThreadSafe
+	bool isEmpty() const;
+
+	//! @returns true if any filter modified the grid
+	//!@ThreadSafe
+	bool apply(const skybolt::QuadTreeTileKey& key, ElevationFilterGrid& grid) const;
+
+	//! Sets the grid's bounds to those of the tile with the given skybolt key
+	static void getTileBounds(const skybolt::QuadTreeTileKey& key, ElevationFilterGrid& grid);
+
+private:
+	mutable std::mutex mMutex;
+	std::vector<std::shared_ptr<const ElevationFilter>> mFilters;
+};
+
+using ElevationFilterChainPtr = std::shared_ptr<ElevationFilterChain>;
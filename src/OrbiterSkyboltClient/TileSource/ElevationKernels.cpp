@@ -0,0 +1,300 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "ElevationKernels.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ELEVATION_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows intrinsics for any instruction set to be used without compiler flags, whereas GCC and Clang require the target to be enabled per function
+#if defined(ELEVATION_KERNELS_X86) && defined(__GNUC__)
+#define ELEVATION_KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define ELEVATION_KERNELS_AVX2_TARGET
+#endif
+
+static constexpr std::uint16_t elevationBias = 32768;
+
+void biasElevationRowScalar(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		out[i] = std::uint16_t(int(source[i]) + elevationBias);
+		boundsInOut.add(out[i]);
+	}
+}
+
+void biasElevationRowScalar(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		out[i] = std::uint16_t(int(source[i]) + elevationBias);
+		boundsInOut.add(out[i]);
+	}
+}
+
+static constexpr float normalComponentScale = 127.0f;
+static constexpr int normalComponentBias = 128;
+
+void computeNormalRowScalar(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		// Normal is (-eastSlope, -northSlope, 1) normalized. Operations are ordered to match the vectorized kernel exactly.
+		float eastSlope = float(int(centre[i + 2]) - int(centre[i])) * eastScale;
+		float northSlope = float(int(north[i + 1]) - int(south[i + 1])) * northScale;
+		float normalizer = normalComponentScale / std::sqrt(eastSlope * eastSlope + northSlope * northSlope + 1.0f);
+		int east = int(std::nearbyint(-eastSlope * normalizer)) + normalComponentBias;
+		int northComponent = int(std::nearbyint(-northSlope * normalizer)) + normalComponentBias;
+		out[i] = std::uint16_t(east | (northComponent << 8));
+	}
+}
+
+#ifdef ELEVATION_KERNELS_X86
+
+static bool isAvx2Supported()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// AVX2 also requires the OS to save YMM registers
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool avx2Supported = isAvx2Supported();
+
+// For int16 sources, adding the bias is equivalent to flipping the sign bit.
+// For uint8 sources, the biased value never carries into the sign bit, so the bias can also be applied with an OR.
+// Biasing preserves order, so bounds are tracked in the source domain where SSE2 has min/max instructions.
+
+template <typename T, int N>
+static void addSourceBounds(const T (&mins)[N], const T (&maxs)[N], ElevationTexelBounds& boundsInOut)
+{
+	for (int i = 0; i < N; ++i)
+	{
+		boundsInOut.add(std::uint16_t(int(mins[i]) + elevationBias));
+		boundsInOut.add(std::uint16_t(int(maxs[i]) + elevationBias));
+	}
+}
+
+static void biasElevationRowSse2(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(short(elevationBias));
+	__m128i minValue = _mm_set1_epi8(char(0xFF));
+	__m128i maxValue = zero;
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		minValue = _mm_min_epu8(minValue, v);
+		maxValue = _mm_max_epu8(maxValue, v);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_unpacklo_epi8(v, zero), bias));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_or_si128(_mm_unpackhi_epi8(v, zero), bias));
+	}
+
+	if (i > 0)
+	{
+		std::uint8_t mins[16], maxs[16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mins), minValue);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), maxValue);
+		addSourceBounds(mins, maxs, boundsInOut);
+	}
+	biasElevationRowScalar(source + i, out + i, count - i, boundsInOut);
+}
+
+static void biasElevationRowSse2(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	const __m128i bias = _mm_set1_epi16(short(elevationBias));
+	__m128i minValue = _mm_set1_epi16(INT16_MAX);
+	__m128i maxValue = _mm_set1_epi16(INT16_MIN);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		minValue = _mm_min_epi16(minValue, v);
+		maxValue = _mm_max_epi16(maxValue, v);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(v, bias));
+	}
+
+	if (i > 0)
+	{
+		std::int16_t mins[8], maxs[8];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mins), minValue);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), maxValue);
+		addSourceBounds(mins, maxs, boundsInOut);
+	}
+	biasElevationRowScalar(source + i, out + i, count - i, boundsInOut);
+}
+
+ELEVATION_KERNELS_AVX2_TARGET
+static void biasElevationRowAvx2(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	const __m256i bias = _mm256_set1_epi16(short(elevationBias));
+	__m128i minValue = _mm_set1_epi8(char(0xFF));
+	__m128i maxValue = _mm_setzero_si128();
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		minValue = _mm_min_epu8(minValue, v);
+		maxValue = _mm_max_epu8(maxValue, v);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(_mm256_cvtepu8_epi16(v), bias));
+	}
+
+	if (i > 0)
+	{
+		std::uint8_t mins[16], maxs[16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mins), minValue);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), maxValue);
+		addSourceBounds(mins, maxs, boundsInOut);
+	}
+	biasElevationRowScalar(source + i, out + i, count - i, boundsInOut);
+}
+
+ELEVATION_KERNELS_AVX2_TARGET
+static void biasElevationRowAvx2(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	const __m256i bias = _mm256_set1_epi16(short(elevationBias));
+	__m256i minValue = _mm256_set1_epi16(INT16_MAX);
+	__m256i maxValue = _mm256_set1_epi16(INT16_MIN);
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+		minValue = _mm256_min_epi16(minValue, v);
+		maxValue = _mm256_max_epi16(maxValue, v);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(v, bias));
+	}
+
+	if (i > 0)
+	{
+		std::int16_t mins[16], maxs[16];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), minValue);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), maxValue);
+		addSourceBounds(mins, maxs, boundsInOut);
+	}
+	biasElevationRowScalar(source + i, out + i, count - i, boundsInOut);
+}
+
+//! @returns int32 differences between four pairs of texels
+static __m128i subtractTexels4(const std::uint16_t* a, const std::uint16_t* b)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i va = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a)), zero);
+	__m128i vb = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b)), zero);
+	return _mm_sub_epi32(va, vb);
+}
+
+//! @returns east and north components of four normals as int32, mapped to [1, 255]
+static void computeNormals4(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north,
+	__m128 eastScale, __m128 northScale, __m128i& eastOut, __m128i& northOut)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 componentScale = _mm_set1_ps(normalComponentScale);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128i bias = _mm_set1_epi32(normalComponentBias);
+
+	__m128 eastSlope = _mm_mul_ps(_mm_cvtepi32_ps(subtractTexels4(centre + 2, centre)), eastScale);
+	__m128 northSlope = _mm_mul_ps(_mm_cvtepi32_ps(subtractTexels4(north + 1, south + 1)), northScale);
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(eastSlope, eastSlope), _mm_mul_ps(northSlope, northSlope)), one));
+	__m128 normalizer = _mm_div_ps(componentScale, length);
+
+	// Conversion rounds to nearest even, the same as std::nearbyint() in the default rounding mode
+	eastOut = _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_xor_ps(eastSlope, signMask), normalizer)), bias);
+	northOut = _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_xor_ps(northSlope, signMask), normalizer)), bias);
+}
+
+static void computeNormalRowSse2(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out)
+{
+	const __m128 eastScaleV = _mm_set1_ps(eastScale);
+	const __m128 northScaleV = _mm_set1_ps(northScale);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i eastA, northA, eastB, northB;
+		computeNormals4(south + i, centre + i, north + i, eastScaleV, northScaleV, eastA, northA);
+		computeNormals4(south + i + 4, centre + i + 4, north + i + 4, eastScaleV, northScaleV, eastB, northB);
+
+		// Components are within [1, 255], so pack to int16 without saturating
+		__m128i east = _mm_packs_epi32(eastA, eastB);
+		__m128i northComponent = _mm_packs_epi32(northA, northB);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(east, _mm_slli_epi16(northComponent, 8)));
+	}
+	computeNormalRowScalar(south + i, centre + i, north + i, count - i, eastScale, northScale, out + i);
+}
+
+void biasElevationRow(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	avx2Supported ? biasElevationRowAvx2(source, out, count, boundsInOut) : biasElevationRowSse2(source, out, count, boundsInOut);
+}
+
+void biasElevationRow(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	avx2Supported ? biasElevationRowAvx2(source, out, count, boundsInOut) : biasElevationRowSse2(source, out, count, boundsInOut);
+}
+
+void computeNormalRow(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out)
+{
+	computeNormalRowSse2(south, centre, north, count, eastScale, northScale, out);
+}
+
+#else
+
+void biasElevationRow(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	biasElevationRowScalar(source, out, count, boundsInOut);
+}
+
+void biasElevationRow(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut)
+{
+	biasElevationRowScalar(source, out, count, boundsInOut);
+}
+
+void computeNormalRow(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out)
+{
+	computeNormalRowScalar(south, centre, north, count, eastScale, northScale, out);
+}
+
+#endif // ELEVATION_KERNELS_X86
@@ -0,0 +1,54 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+//! Row kernels for converting raw Orbiter elevation values to texels biased by 32768.
+//! Vectorized with AVX2 or SSE2 where the CPU supports it, falling back to scalar code otherwise.
+//! All implementations produce identical results. Source and destination need not be aligned.
+
+//! Range of texel values
+struct ElevationTexelBounds
+{
+	std::uint16_t min = UINT16_MAX;
+	std::uint16_t max = 0;
+
+	bool isEmpty() const { return min > max; }
+
+	void add(std::uint16_t texel)
+	{
+		min = std::min(min, texel);
+		max = std::max(max, texel);
+	}
+};
+
+//! Writes biased texels to out, and expands boundsInOut to include them
+void biasElevationRow(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut);
+void biasElevationRow(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut);
+
+//! Scalar reference implementations
+void biasElevationRowScalar(const std::uint8_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut);
+void biasElevationRowScalar(const std::int16_t* source, std::uint16_t* out, int count, ElevationTexelBounds& boundsInOut);
+
+//! Computes packed terrain normals for a row of texels by central differences.
+//! The rows to the south and north and the centre row must have count + 2 texels, where output i is centred on texel i + 1.
+//! Each output has the normal's east component in the low byte and north component in the high byte, each mapped from [-1, 1] to [1, 255].
+//! @param eastScale converts the texel difference between east and west neighbours to a slope
+//! @param northScale converts the texel difference between north and south neighbours to a slope
+void computeNormalRow(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out);
+
+//! Scalar reference implementation
+void computeNormalRowScalar(const std::uint16_t* south, const std::uint16_t* centre, const std::uint16_t* north, int count,
+	float eastScale, float northScale, std::uint16_t* out);
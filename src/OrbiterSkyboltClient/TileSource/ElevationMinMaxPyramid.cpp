@@ -0,0 +1,127 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "ElevationMinMaxPyramid.h"
+
+#include <algorithm>
+#include <assert.h>
+
+static int divideRoundingUp(int a, int b)
+{
+	return (a + b - 1) / b;
+}
+
+ElevationMinMaxPyramid::ElevationMinMaxPyramid(const std::uint16_t* texels, int width, int height)
+{
+	assert(width >= 2 && height >= 2);
+	const int cellCountX = width - 1;
+	const int cellCountY = height - 1;
+
+	Level finest;
+	finest.blockCountX = divideRoundingUp(cellCountX, finestBlockSize);
+	finest.blockCountY = divideRoundingUp(cellCountY, finestBlockSize);
+	finest.bounds.resize(finest.blockCountX * finest.blockCountY);
+
+	for (int by = 0; by < finest.blockCountY; ++by)
+	{
+		int y0 = by * finestBlockSize;
+		int y1 = std::min(y0 + finestBlockSize, cellCountY);
+		for (int bx = 0; bx < finest.blockCountX; ++bx)
+		{
+			int x0 = bx * finestBlockSize;
+			int x1 = std::min(x0 + finestBlockSize, cellCountX);
+
+			ElevationTexelBounds& bounds = finest.bounds[by * finest.blockCountX + bx];
+			for (int y = y0; y <= y1; ++y)
+			{
+				const std::uint16_t* row = texels + y * width;
+				for (int x = x0; x <= x1; ++x)
+				{
+					bounds.add(row[x]);
+				}
+			}
+		}
+	}
+	mLevels.push_back(std::move(finest));
+
+	while (mLevels.back().blockCountX > 1 || mLevels.back().blockCountY > 1)
+	{
+		const Level& fine = mLevels.back();
+		Level coarse;
+		coarse.blockCountX = divideRoundingUp(fine.blockCountX, 2);
+		coarse.blockCountY = divideRoundingUp(fine.blockCountY, 2);
+		coarse.bounds.resize(coarse.blockCountX * coarse.blockCountY);
+
+		for (int y = 0; y < fine.blockCountY; ++y)
+		{
+			for (int x = 0; x < fine.blockCountX; ++x)
+			{
+				const ElevationTexelBounds& fineBounds = fine.bounds[y * fine.blockCountX + x];
+				ElevationTexelBounds& coarseBounds = coarse.bounds[(y / 2) * coarse.blockCountX + x / 2];
+				coarseBounds.add(fineBounds.min);
+				coarseBounds.add(fineBounds.max);
+			}
+		}
+		mLevels.push_back(std::move(coarse));
+	}
+}
+
+ElevationMinMaxPyramid::ElevationMinMaxPyramid(const ElevationTexelBounds& uniformBounds, int width, int height) :
+	mUniformBounds(uniformBounds)
+{
+	assert(width >= 2 && height >= 2);
+	Level level;
+	level.blockCountX = divideRoundingUp(width - 1, finestBlockSize);
+	level.blockCountY = divideRoundingUp(height - 1, finestBlockSize);
+	mLevels.push_back(level);
+
+	while (level.blockCountX > 1 || level.blockCountY > 1)
+	{
+		level.blockCountX = divideRoundingUp(level.blockCountX, 2);
+		level.blockCountY = divideRoundingUp(level.blockCountY, 2);
+		mLevels.push_back(level);
+	}
+}
+
+ElevationTexelBounds ElevationMinMaxPyramid::getBoundsInRect(int minX, int minY, int maxX, int maxY) const
+{
+	if (mUniformBounds)
+	{
+		return *mUniformBounds;
+	}
+
+	// Convert texel rect to the range of finest blocks containing it. Texels on block edges belong to both neighbours, so either will do.
+	const Level& finest = mLevels.front();
+	int bx0 = std::clamp(minX / finestBlockSize, 0, finest.blockCountX - 1);
+	int by0 = std::clamp(minY / finestBlockSize, 0, finest.blockCountY - 1);
+	int bx1 = std::clamp((maxX - 1) / finestBlockSize, bx0, finest.blockCountX - 1);
+	int by1 = std::clamp((maxY - 1) / finestBlockSize, by0, finest.blockCountY - 1);
+
+	// Use the finest level where the rect spans at most two blocks in each dimension
+	int level = 0;
+	while (level + 1 < getLevelCount() && (bx1 - bx0 > 1 || by1 - by0 > 1))
+	{
+		bx0 /= 2; by0 /= 2; bx1 /= 2; by1 /= 2;
+		++level;
+	}
+
+	ElevationTexelBounds result;
+	for (int by = by0; by <= by1; ++by)
+	{
+		for (int bx = bx0; bx <= bx1; ++bx)
+		{
+			const ElevationTexelBounds& bounds = getBounds(level, bx, by);
+			result.add(bounds.min);
+			result.add(bounds.max);
+		}
+	}
+	return result;
+}
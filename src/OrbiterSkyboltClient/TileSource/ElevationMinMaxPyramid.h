@@ -0,0 +1,65 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "ElevationKernels.h"
+
+#include <optional>
+#include <vector>
+
+//! Hierarchy of texel bounds over square blocks of a height grid's cells, for rejecting large areas without reading texels.
+//! Level 0 has blocks of finestBlockSize cells. Each subsequent level halves the block count in each dimension, down to a single block.
+//! Each block's bounds include the texels on its edges, so bounds of adjacent blocks overlap on shared edges.
+//! A uniform pyramid stores a single bounds shared by every block, for grids where per-block bounds would add nothing.
+class ElevationMinMaxPyramid
+{
+public:
+	static constexpr int finestBlockSize = 8;
+
+	ElevationMinMaxPyramid(const std::uint16_t* texels, int width, int height);
+
+	//! Creates a uniform pyramid where every block has the given bounds
+	ElevationMinMaxPyramid(const ElevationTexelBounds& uniformBounds, int width, int height);
+
+	int getLevelCount() const { return int(mLevels.size()); }
+	int getBlockCountX(int level) const { return mLevels[level].blockCountX; }
+	int getBlockCountY(int level) const { return mLevels[level].blockCountY; }
+
+	//! @returns block size in cells
+	int getBlockSize(int level) const { return finestBlockSize << level; }
+
+	const ElevationTexelBounds& getBounds(int level, int blockX, int blockY) const
+	{
+		if (mUniformBounds)
+		{
+			return *mUniformBounds;
+		}
+		const Level& l = mLevels[level];
+		return l.bounds[blockY * l.blockCountX + blockX];
+	}
+
+	//! @returns bounds of the whole grid
+	const ElevationTexelBounds& getBounds() const { return mUniformBounds ? *mUniformBounds : mLevels.back().bounds.front(); }
+
+	//! @returns conservative bounds of the texels in the given inclusive texel rectangle, using the coarsest blocks which cover it
+	ElevationTexelBounds getBoundsInRect(int minX, int minY, int maxX, int maxY) const;
+
+private:
+	struct Level
+	{
+		int blockCountX;
+		int blockCountY;
+		std::vector<ElevationTexelBounds> bounds;
+	};
+	std::vector<Level> mLevels; //!< Bounds are empty if uniform
+	std::optional<ElevationTexelBounds> mUniformBounds;
+};
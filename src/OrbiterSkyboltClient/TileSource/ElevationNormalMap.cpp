@@ -0,0 +1,52 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "ElevationNormalMap.h"
+#include "ElevationKernels.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+ElevationNormalMap::ElevationNormalMap(const std::uint16_t* paddedTexels, int width, int height, const Geometry& geometry) :
+	mWidth(width),
+	mHeight(height),
+	mNormals(std::size_t(width) * height)
+{
+	assert(width >= 1 && height >= 1);
+	const int paddedWidth = width + 2;
+
+	// Central differences span two cells
+	const double cellSizeNorth = geometry.cellSizeLatitude * geometry.planetRadius;
+	const float northScale = float(geometry.elevationScale / (2 * cellSizeNorth));
+
+	// Cells narrow towards the poles. Limit the slope scale so that rows on the poles don't divide by zero.
+	constexpr double minCosLatitude = 1e-6;
+
+	for (int y = 0; y < height; ++y)
+	{
+		double latitude = geometry.southLatitude + y * geometry.cellSizeLatitude;
+		double cellSizeEast = geometry.cellSizeLongitude * geometry.planetRadius * std::max(minCosLatitude, std::cos(latitude));
+		float eastScale = float(geometry.elevationScale / (2 * cellSizeEast));
+
+		const std::uint16_t* centre = paddedTexels + (y + 1) * paddedWidth;
+		computeNormalRow(centre - paddedWidth, centre, centre + paddedWidth, width, eastScale, northScale, mNormals.data() + y * width);
+	}
+}
+
+osg::Vec3f ElevationNormalMap::getNormal(int x, int y) const
+{
+	std::uint16_t packed = mNormals[y * mWidth + x];
+	float east = (int(packed & 0xFF) - 128) / 127.0f;
+	float north = (int(packed >> 8) - 128) / 127.0f;
+	float up = std::sqrt(std::max(0.0f, 1.0f - east * east - north * north));
+	return osg::Vec3f(east, north, up);
+}
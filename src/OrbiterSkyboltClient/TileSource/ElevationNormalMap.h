@@ -0,0 +1,56 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <osg/Vec3f>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//! Terrain normals of a height grid, packed into two bytes per texel.
+//! The low byte holds the normal's east component and the high byte its north component, each mapped from [-1, 1] to [1, 255].
+//! The up component is always positive, so is reconstructed from the other two. Rows run from south to north.
+class ElevationNormalMap
+{
+public:
+	//! Describes the grid's placement on the planet
+	struct Geometry
+	{
+		double southLatitude; //!< Latitude of the first row, in radians
+		double cellSizeLatitude; //!< In radians
+		double cellSizeLongitude; //!< In radians
+		double planetRadius; //!< In meters
+		double elevationScale; //!< Meters per texel unit
+	};
+
+	//! @param paddedTexels is a (width + 2) x (height + 2) grid, with a border one texel wide taken from adjacent tiles.
+	//! The border makes derivatives on the grid's edges match those of adjacent tiles, so lighting is seamless.
+	ElevationNormalMap(const std::uint16_t* paddedTexels, int width, int height, const Geometry& geometry);
+
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+
+	const std::uint16_t* getData() const { return mNormals.data(); }
+
+	std::size_t getSizeBytes() const { return mNormals.size() * sizeof(std::uint16_t); }
+
+	//! @returns unit normal in the local east, north, up frame
+	osg::Vec3f getNormal(int x, int y) const;
+
+private:
+	int mWidth;
+	int mHeight;
+	std::vector<std::uint16_t> mNormals;
+};
+
+using ElevationNormalMapPtr = std::shared_ptr<const ElevationNormalMap>;
@@ -0,0 +1,128 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "FeaturePlacement.h"
+
+#include <algorithm>
+#include <cmath>
+
+//! Mixes the bits of x, giving a well distributed pseudo random number for each input
+static std::uint64_t mixBits(std::uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+//! @returns number in range [0, 1)
+static double toUnitInterval(std::uint64_t x)
+{
+	return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void ElevationSampler::sample(double u, double v, double cosLatitude, double& elevationOut, double& slopeOut) const
+{
+	// Texels lie on the tile's edges
+	double x = std::clamp(mapping.offsetU + u * mapping.scale, 0.0, 1.0) * (width - 1);
+	double y = std::clamp(mapping.offsetV + v * mapping.scale, 0.0, 1.0) * (height - 1);
+
+	int x0 = std::min(int(x), width - 2);
+	int y0 = std::min(int(y), height - 2);
+	double fx = x - x0;
+	double fy = y - y0;
+
+	const std::uint16_t* row0 = texels.data() + y0 * width + x0;
+	const std::uint16_t* row1 = row0 + width;
+	double bottom = row0[0] + (row0[1] - row0[0]) * fx;
+	double top = row1[0] + (row1[1] - row1[0]) * fx;
+	elevationOut = (bottom + (top - bottom) * fy - 32768) * scale + offset;
+
+	// Derivatives of the bilinear interpolant, in meters per meter
+	double dEast = (row0[1] - row0[0]) + ((row1[1] - row1[0]) - (row0[1] - row0[0])) * fy;
+	double dNorth = top - bottom;
+	dEast *= scale / (texelSizeLatitude * cosLatitude);
+	dNorth *= scale / texelSizeLatitude;
+	slopeOut = std::sqrt(dEast * dEast + dNorth * dNorth);
+}
+
+FeaturePlacementTilePtr placeFeatures(const FeaturePlacementConfig& config, const FeaturePlacementInputs& inputs)
+{
+	auto result = std::make_shared<FeaturePlacementTile>();
+
+	const LandMaskTile* landMask = inputs.landMask;
+	if (landMask && landMask->getCoverage() == LandMaskTile::Coverage::Water)
+	{
+		return result; // Nowhere to place features
+	}
+
+	// Place one candidate per cell, jittered within the cell. Each cell draws its numbers from a seed derived from
+	// the tile and cell index, so placement does not depend on the order or thread in which tiles are placed.
+	const int cellsPerSide = config.cellsPerTileSide;
+	const std::uint64_t tileSeed = mixBits(inputs.tileId);
+
+	for (int cellY = 0; cellY < cellsPerSide; ++cellY)
+	{
+		for (int cellX = 0; cellX < cellsPerSide; ++cellX)
+		{
+			std::uint64_t seed = mixBits(tileSeed ^ std::uint64_t(cellY * cellsPerSide + cellX));
+			auto random = [&seed] {
+				seed = mixBits(seed);
+				return toUnitInterval(seed);
+			};
+
+			if (random() >= config.density)
+			{
+				continue;
+			}
+
+			double u = (cellX + random()) / cellsPerSide;
+			double v = (cellY + random()) / cellsPerSide;
+
+			if (landMask)
+			{
+				// Mask rows start at the southern edge of the tile
+				const AncestorMapping& mapping = inputs.landMaskMapping;
+				int x = std::min(int((mapping.offsetU + u * mapping.scale) * landMask->getWidth()), landMask->getWidth() - 1);
+				int y = std::min(int((mapping.offsetV + v * mapping.scale) * landMask->getHeight()), landMask->getHeight() - 1);
+				if (landMask->isWater(x, y))
+				{
+					continue;
+				}
+			}
+
+			double elevationValue = 0;
+			if (inputs.elevation)
+			{
+				double cosLatitude = std::max(1e-3, std::cos(inputs.southLatitude + v * inputs.size));
+				double slope;
+				inputs.elevation->sample(u, v, cosLatitude, elevationValue, slope);
+				if (slope > config.maxSlope || elevationValue > config.maxElevation)
+				{
+					continue;
+				}
+			}
+
+			FeatureInstance instance;
+			instance.u = std::uint16_t(std::min(u * 65536.0, 65535.0));
+			instance.v = std::uint16_t(std::min(v * 65536.0, 65535.0));
+			instance.elevation = float(elevationValue);
+			instance.type = FeatureType::Tree;
+			instance.variant = std::uint8_t(std::min(int(random() * config.variantCount), config.variantCount - 1));
+			instance.heading = std::uint8_t(random() * 256.0);
+			instance.scale = std::uint8_t(std::clamp((config.minScale + random() * (config.maxScale - config.minScale)) * 128.0, 1.0, 255.0));
+			result->instances.push_back(instance);
+		}
+	}
+
+	result->instances.shrink_to_fit();
+	return result;
+}
@@ -0,0 +1,97 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "LandMaskTile.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class FeatureType : std::uint8_t
+{
+	Tree
+};
+
+//! Feature placed on a tile, packed into 12 bytes since dense tiles hold thousands of features
+struct FeatureInstance
+{
+	std::uint16_t u; //!< Eastward position from the tile's western edge, in units of 1/65536 of the tile's width
+	std::uint16_t v; //!< Northward position from the tile's southern edge, in units of 1/65536 of the tile's height
+	float elevation; //!< Meters above mean planet radius
+	FeatureType type;
+	std::uint8_t variant; //!< Index of the feature's model within its type
+	std::uint8_t heading; //!< Clockwise from north, in units of 2 pi / 256 radians
+	std::uint8_t scale; //!< Scale factor in units of 1/128
+};
+
+struct FeaturePlacementTile
+{
+	std::vector<FeatureInstance> instances;
+};
+
+using FeaturePlacementTilePtr = std::shared_ptr<const FeaturePlacementTile>;
+
+struct FeaturePlacementConfig
+{
+	int level = 14; //!< Level of the tiles features are placed on
+	int cellsPerTileSide = 64; //!< Each tile is split into cells holding at most one feature each
+	double density = 0.6; //!< Probability of a cell on suitable terrain holding a feature
+	double maxSlope = 0.6; //!< Max tangent of the terrain slope under a feature
+	double maxElevation = 3000; //!< Meters. Features are not placed above this elevation.
+	int variantCount = 1;
+	double minScale = 0.8;
+	double maxScale = 1.25;
+	double planetRadius = 6371000; //!< Meters
+	std::size_t cacheCapacity = 1024; //!< Max number of placed tiles kept resident
+};
+
+//! Maps coordinates within a tile to coordinates within one of its ancestors, or the tile itself.
+//! Coordinates run east and north from the tile's south west corner, in the range [0, 1].
+struct AncestorMapping
+{
+	double offsetU = 0;
+	double offsetV = 0;
+	double scale = 1; //!< Size of the tile relative to the ancestor
+};
+
+//! Elevation tile expanded for sampling
+struct ElevationSampler
+{
+	std::vector<std::uint16_t> texels; //!< Raw values biased by 32768. Rows start at the southern edge of the tile.
+	int width;
+	int height;
+	double scale; //!< Elevation = raw value * scale + offset
+	double offset;
+	AncestorMapping mapping; //!< Maps the placed tile to the elevation tile
+	double texelSizeLatitude; //!< Meters
+
+	//! @param u and v are coordinates within the placed tile
+	void sample(double u, double v, double cosLatitude, double& elevationOut, double& slopeOut) const;
+};
+
+//! Inputs for placing features on one tile
+struct FeaturePlacementInputs
+{
+	std::uint64_t tileId; //!< Unique per tile, such as the tile's cache key. Seeds the tile's placement.
+	double southLatitude; //!< Radians
+	double size; //!< Angular size of the tile in radians
+
+	const LandMaskTile* landMask = nullptr; //!< Null if all terrain is land
+	AncestorMapping landMaskMapping; //!< Maps the placed tile to the land mask tile
+
+	const ElevationSampler* elevation = nullptr; //!< Null if terrain is flat at zero elevation
+};
+
+//! Places features on a tile.
+//! Placement only depends on the config and inputs, so is the same regardless of the order or thread in which tiles are placed.
+FeaturePlacementTilePtr placeFeatures(const FeaturePlacementConfig& config, const FeaturePlacementInputs& inputs);
@@ -0,0 +1,196 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "FeaturePlacementCache.h"
+#include "OrbiterElevationTileSource.h"
+#include "OrbiterImageTileSource.h"
+#include "TileWorkerPool.h"
+
+#include <assert.h>
+#include <mutex>
+#include <unordered_set>
+
+using namespace skybolt;
+
+constexpr double pi = 3.14159265358979323846;
+
+struct FeaturePlacementCache::State
+{
+	State(const FeaturePlacementConfig& config) : config(config), tiles(config.cacheCapacity) {}
+
+	FeaturePlacementConfig config;
+	std::shared_ptr<const OrbiterImageTileSource> landMaskSource;
+	std::shared_ptr<const OrbiterElevationTileSource> elevationSource;
+
+	TileCache<FeaturePlacementTilePtr> tiles;
+
+	std::mutex pendingKeysMutex;
+	std::unordered_set<std::uint64_t> pendingKeys; //!< Keys of tiles queued for placement
+};
+
+FeaturePlacementCache::FeaturePlacementCache(const FeaturePlacementConfig& config, std::shared_ptr<const OrbiterImageTileSource> landMaskSource,
+	std::shared_ptr<const OrbiterElevationTileSource> elevationSource, const std::shared_ptr<TileWorkerPool>& workerPool) :
+	mState(std::make_shared<State>(config)),
+	mWorkerPool(workerPool)
+{
+	assert(workerPool);
+	assert(config.cellsPerTileSide > 0 && config.cellsPerTileSide <= 1024);
+	assert(config.variantCount > 0 && config.variantCount <= 256);
+	mState->landMaskSource = std::move(landMaskSource);
+	mState->elevationSource = std::move(elevationSource);
+}
+
+FeaturePlacementCache::~FeaturePlacementCache() = default;
+
+const FeaturePlacementConfig& FeaturePlacementCache::getConfig() const
+{
+	return mState->config;
+}
+
+namespace {
+
+//! @returns mapping from the key's tile to the ancestor's tile
+AncestorMapping getAncestorMapping(const QuadTreeTileKey& key, const QuadTreeTileKey& ancestor)
+{
+	assert(ancestor.level <= key.level);
+	int levelDelta = key.level - ancestor.level;
+	int tileCount = 1 << levelDelta;
+
+	// Tile rows are numbered from north to south
+	AncestorMapping mapping;
+	mapping.offsetU = double(key.x - (ancestor.x << levelDelta)) / tileCount;
+	mapping.offsetV = double(tileCount - 1 - (key.y - (ancestor.y << levelDelta))) / tileCount;
+	mapping.scale = 1.0 / tileCount;
+	return mapping;
+}
+
+//! @returns the finest tile available at or above the key's level, or nullopt if none is available
+template <class SourceT>
+std::optional<QuadTreeTileKey> findAvailableKey(const SourceT& source, const QuadTreeTileKey& key)
+{
+	std::optional<QuadTreeTileKey> availableKey = source.getHighestStoredLevel(key);
+	if (availableKey && availableKey->level > key.level)
+	{
+		availableKey = key;
+	}
+	return availableKey;
+}
+
+//! Reads the tile's inputs and places its features
+//! @returns null if an available land mask or elevation tile could not be read
+FeaturePlacementTilePtr placeTileFeatures(const FeaturePlacementConfig& config, const OrbiterImageTileSource* landMaskSource,
+	const OrbiterElevationTileSource* elevationSource, const QuadTreeTileKey& key)
+{
+	FeaturePlacementInputs inputs;
+	inputs.tileId = toTileCacheKey(key);
+	inputs.size = pi / (1 << key.level);
+	inputs.southLatitude = pi / 2 - (key.y + 1) * inputs.size;
+
+	LandMaskTilePtr landMask;
+	if (landMaskSource)
+	{
+		std::optional<QuadTreeTileKey> maskKey = findAvailableKey(*landMaskSource, key);
+		if (!maskKey)
+		{
+			return std::make_shared<FeaturePlacementTile>(); // No land to place features on
+		}
+
+		landMask = landMaskSource->getLandMask(*maskKey);
+		if (!landMask)
+		{
+			return nullptr;
+		}
+		inputs.landMask = landMask.get();
+		inputs.landMaskMapping = getAncestorMapping(key, *maskKey);
+	}
+
+	std::optional<ElevationSampler> elevation;
+	if (elevationSource)
+	{
+		if (std::optional<QuadTreeTileKey> elevationKey = findAvailableKey(*elevationSource, key); elevationKey)
+		{
+			DecodedElevationTilePtr tile = elevationSource->getTile(*elevationKey);
+			if (!tile)
+			{
+				return nullptr;
+			}
+
+			elevation = ElevationSampler{{}, tile->texels.getWidth(), tile->texels.getHeight(), tile->scale, tile->offset, getAncestorMapping(key, *elevationKey), 0};
+			elevation->texels.resize(std::size_t(elevation->width) * elevation->height);
+			tile->texels.decode(elevation->texels.data());
+			elevation->texelSizeLatitude = (pi / (1 << elevationKey->level)) * config.planetRadius / (elevation->height - 1);
+			inputs.elevation = &*elevation;
+		}
+	}
+
+	return placeFeatures(config, inputs);
+}
+
+} // namespace
+
+FeaturePlacementTilePtr FeaturePlacementCache::getTile(const QuadTreeTileKey& key) const
+{
+	if (key.level != mState->config.level)
+	{
+		return nullptr;
+	}
+
+	if (std::optional<FeaturePlacementTilePtr> tile = mState->tiles.get(key); tile)
+	{
+		return *tile;
+	}
+
+	std::shared_ptr<TileWorkerPool> workerPool = mWorkerPool.lock();
+	if (!workerPool)
+	{
+		return nullptr;
+	}
+
+	std::uint64_t cacheKey = toTileCacheKey(key);
+	{
+		std::scoped_lock<std::mutex> lock(mState->pendingKeysMutex);
+		if (!mState->pendingKeys.insert(cacheKey).second)
+		{
+			return nullptr; // Already pending
+		}
+	}
+
+	workerPool->submit([state = mState, key, cacheKey] {
+		// Tiles whose inputs could not be read are left uncached, so are queued again by a later request
+		if (FeaturePlacementTilePtr tile = placeTileFeatures(state->config, state->landMaskSource.get(), state->elevationSource.get(), key); tile)
+		{
+			state->tiles.put(key, tile);
+		}
+		std::scoped_lock<std::mutex> lock(state->pendingKeysMutex);
+		state->pendingKeys.erase(cacheKey);
+	});
+	return nullptr;
+}
+
+FeaturePlacementTilePtr FeaturePlacementCache::placeTile(const QuadTreeTileKey& key) const
+{
+	if (key.level != mState->config.level)
+	{
+		return nullptr;
+	}
+
+	if (std::optional<FeaturePlacementTilePtr> tile = mState->tiles.get(key); tile)
+	{
+		return *tile;
+	}
+
+	FeaturePlacementTilePtr tile = placeTileFeatures(mState->config, mState->landMaskSource.get(), mState->elevationSource.get(), key);
+	if (tile)
+	{
+		mState->tiles.put(key, tile);
+	}
+	return tile;
+}
@@ -0,0 +1,57 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "FeaturePlacement.h"
+#include "TileCache.h"
+
+#include <SkyboltCommon/Math/QuadTree.h>
+
+#include <memory>
+
+class OrbiterElevationTileSource;
+class OrbiterImageTileSource;
+class TileWorkerPool;
+
+//! Places features such as trees on a planet's tiles, driven by the land mask and elevation tiles.
+//! Each tile is placed once on the worker pool the first time it is requested, then cached, so placement is not repeated per frame or per visit.
+//! Placement is deterministic per tile key, so evicted tiles are placed identically if requested again.
+//! Land mask and elevation tiles are taken from the finest available level at or above the placement level.
+//! Tiles whose land mask or elevation could not be read are not cached, so that they are placed again on a later request.
+//! Nothing renders the placed features yet.
+class FeaturePlacementCache
+{
+public:
+	//! @param landMaskSource may be null, in which case all terrain is treated as land
+	//! @param elevationSource may be null, in which case terrain is treated as flat at zero elevation
+	FeaturePlacementCache(const FeaturePlacementConfig& config, std::shared_ptr<const OrbiterImageTileSource> landMaskSource,
+		std::shared_ptr<const OrbiterElevationTileSource> elevationSource, const std::shared_ptr<TileWorkerPool>& workerPool);
+	~FeaturePlacementCache();
+
+	const FeaturePlacementConfig& getConfig() const;
+
+	//! @returns the tile's features if placed, otherwise null. Tiles which have not been placed are queued for placement
+	//! if the worker pool still exists. Returns null for tiles which are not at the placement level.
+	//!@ThreadSafe
+	FeaturePlacementTilePtr getTile(const skybolt::QuadTreeTileKey& key) const;
+
+	//! @returns the tile's features, placing them on the calling thread if they are not cached.
+	//! Returns null for tiles which are not at the placement level, or whose inputs could not be read.
+	//!@ThreadSafe
+	FeaturePlacementTilePtr placeTile(const skybolt::QuadTreeTileKey& key) const;
+
+private:
+	// Shared with queued placement tasks so that they can safely outlive the cache
+	struct State;
+	std::shared_ptr<State> mState;
+	std::weak_ptr<TileWorkerPool> mWorkerPool; //!< Weak so that the cache doesn't keep the client's pool alive
+};
@@ -0,0 +1,284 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "LandMaskCoverageIndex.h"
+#include "DdsImage.h"
+#include "TileWorkerPool.h"
+#include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
+
+#include <OrbiterAPI.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdio.h>
+
+namespace {
+
+constexpr std::uint32_t indexFileMagic = 0x49434D4C; // "LMCI"
+constexpr std::uint32_t indexFileVersion = 1;
+
+//! Identifies the archive an index file was created from, so that the index is rebuilt if the archive changes
+struct IndexFileHeader
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint64_t archiveSize;
+	std::int64_t archiveWriteTime;
+	std::uint32_t nodeCount;
+	std::uint32_t reserved;
+};
+static_assert(sizeof(IndexFileHeader) == 32, "Index file header must not be padded");
+
+constexpr int coverageBitCount = 2;
+constexpr std::uint8_t coverageMask = (1 << coverageBitCount) - 1;
+
+std::uint8_t encodeEntry(LandMaskTile::Coverage coverage, int tileSizeLog2)
+{
+	return std::uint8_t((tileSizeLog2 << coverageBitCount) | (int(coverage) + 1));
+}
+
+//! @returns log2 of size if it is a power of two, otherwise -1
+int getLog2(int size)
+{
+	int log2 = 0;
+	while ((1 << log2) < size)
+	{
+		++log2;
+	}
+	return ((1 << log2) == size) ? log2 : -1;
+}
+
+std::string getIndexFilename(const ZTreeMgr& treeMgr)
+{
+	return std::string(treeMgr.ArchiveName()) + ".coverage";
+}
+
+std::optional<IndexFileHeader> createHeader(const ZTreeMgr& treeMgr)
+{
+	std::error_code error;
+	std::filesystem::path archivePath(treeMgr.ArchiveName());
+	std::uintmax_t size = std::filesystem::file_size(archivePath, error);
+	if (error)
+	{
+		return std::nullopt;
+	}
+	auto writeTime = std::filesystem::last_write_time(archivePath, error);
+	if (error)
+	{
+		return std::nullopt;
+	}
+
+	IndexFileHeader header = {};
+	header.magic = indexFileMagic;
+	header.version = indexFileVersion;
+	header.archiveSize = size;
+	header.archiveWriteTime = writeTime.time_since_epoch().count();
+	header.nodeCount = treeMgr.TOC().size();
+	return header;
+}
+
+std::optional<std::vector<std::uint8_t>> readIndexFile(const std::string& filename, const IndexFileHeader& expectedHeader)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	IndexFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(&header, &expectedHeader, sizeof(header)) != 0)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<std::uint8_t> entries(header.nodeCount);
+	if (!file.read(reinterpret_cast<char*>(entries.data()), entries.size()))
+	{
+		return std::nullopt;
+	}
+	return entries;
+}
+
+bool writeIndexFile(const std::string& filename, const IndexFileHeader& header, const std::vector<std::uint8_t>& entries)
+{
+	// Write to a temporary file first so that an interrupted write never leaves a partial index
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size());
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFilename, filename, error);
+	return !error;
+}
+
+struct ScanJob
+{
+	std::shared_ptr<const ZTreeMgr> treeMgr;
+	std::shared_ptr<LandMaskCoverageIndex> index; //!< Receives the entries when the scan is finished
+	IndexFileHeader header;
+	std::vector<std::uint8_t> entries; //!< Each task writes a separate range
+	std::atomic<int> remainingTasks = 0;
+	std::atomic<std::uint32_t> unreadNodeCount = 0; //!< Nodes which could not be read. The index is not saved if there are any.
+};
+
+void scanNodes(ScanJob& job, DWORD beginIdx, DWORD endIdx)
+{
+	FILE* file = fopen(job.treeMgr->ArchiveName(), "rb");
+	if (!file)
+	{
+		job.unreadNodeCount += endIdx - beginIdx;
+		return;
+	}
+
+	std::vector<BYTE> zbuf;
+	std::vector<BYTE> ebuf;
+
+	for (DWORD idx = beginIdx; idx < endIdx; ++idx)
+	{
+		DWORD esize = job.treeMgr->NodeSizeInflated(idx);
+		DWORD zsize = job.treeMgr->NodeSizeDeflated(idx);
+		if (esize == 0 || zsize == 0)
+		{
+			continue;
+		}
+
+		zbuf.resize(zsize);
+		ebuf.resize(esize);
+		if (_fseeki64(file, job.treeMgr->DataOffset() + job.treeMgr->TOC()[idx].pos, SEEK_SET) || fread(zbuf.data(), 1, zsize, file) != zsize
+			|| oapiInflate(zbuf.data(), zsize, ebuf.data(), esize) != esize)
+		{
+			++job.unreadNodeCount;
+			continue;
+		}
+
+		// Only square power of two tiles are indexed, which is all tiles in Orbiter archives
+		std::optional<Dxt1DdsLayout> layout = getDxt1DdsLayout(ebuf.data(), esize);
+		if (layout && layout->width == layout->height && layout->width >= 4)
+		{
+			if (int sizeLog2 = getLog2(layout->width); sizeLog2 >= 0)
+			{
+				LandMaskTile::Coverage coverage = LandMaskTile::getDxt1Coverage(ebuf.data() + layout->dataOffset, layout->width, layout->height);
+				job.entries[idx] = encodeEntry(coverage, sizeLog2);
+			}
+		}
+	}
+
+	fclose(file);
+}
+
+void finishScan(ScanJob& job)
+{
+	std::size_t uniformCount = std::count_if(job.entries.begin(), job.entries.end(), [](std::uint8_t entry) {
+		int coverage = (entry & coverageMask) - 1;
+		return coverage == int(LandMaskTile::Coverage::Land) || coverage == int(LandMaskTile::Coverage::Water);
+	});
+
+	// Unread nodes may have failed transiently, so don't persist them as unknown
+	if (std::uint32_t unreadNodeCount = job.unreadNodeCount; unreadNodeCount > 0)
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Could not read " << unreadNodeCount << " of " << job.entries.size() << " nodes while indexing land mask archive '"
+			<< job.treeMgr->ArchiveName() << "'. The index was not saved, so the archive will be scanned again next session.";
+		return;
+	}
+
+	std::string filename = getIndexFilename(*job.treeMgr);
+	if (writeIndexFile(filename, job.header, job.entries))
+	{
+		BOOST_LOG_TRIVIAL(info) << "Indexed land mask archive '" << job.treeMgr->ArchiveName() << "': " << uniformCount << " of " << job.entries.size() << " nodes are all land or all water";
+	}
+	else
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Could not write land mask index '" << filename << "'. The archive will be scanned again next session.";
+	}
+}
+
+} // namespace
+
+std::shared_ptr<LandMaskCoverageIndex> LandMaskCoverageIndex::loadOrScan(TileWorkerPool& workerPool, const std::shared_ptr<const ZTreeMgr>& treeMgr)
+{
+	auto index = std::make_shared<LandMaskCoverageIndex>();
+
+	std::optional<IndexFileHeader> header = createHeader(*treeMgr);
+	if (!header)
+	{
+		return index;
+	}
+
+	if (std::optional<std::vector<std::uint8_t>> entries = readIndexFile(getIndexFilename(*treeMgr), *header); entries)
+	{
+		index->setEntries(std::move(*entries));
+		return index;
+	}
+
+	auto job = std::make_shared<ScanJob>();
+	job->treeMgr = treeMgr;
+	job->index = index;
+	job->header = *header;
+	job->entries.resize(header->nodeCount, 0);
+
+	constexpr std::uint32_t minNodesPerTask = 256;
+	std::vector<TileWorkerPool::IndexRange> ranges = workerPool.splitIntoTaskRanges(header->nodeCount, minNodesPerTask);
+	if (ranges.empty())
+	{
+		return index;
+	}
+
+	job->remainingTasks = int(ranges.size());
+	for (const TileWorkerPool::IndexRange& range : ranges)
+	{
+		workerPool.submit([job, range] {
+			scanNodes(*job, range.begin, range.end);
+			if (--job->remainingTasks == 0)
+			{
+				finishScan(*job);
+				job->index->setEntries(std::move(job->entries));
+			}
+		});
+	}
+	return index;
+}
+
+std::optional<LandMaskCoverageIndex::TileCoverage> LandMaskCoverageIndex::getCoverage(std::uint32_t idx) const
+{
+	if (!isReady() || idx >= mEntries.size() || mEntries[idx] == 0)
+	{
+		return std::nullopt;
+	}
+
+	std::uint8_t entry = mEntries[idx];
+	TileCoverage result;
+	result.coverage = LandMaskTile::Coverage((entry & coverageMask) - 1);
+	result.tileSize = 1 << (entry >> coverageBitCount);
+	return result;
+}
+
+void LandMaskCoverageIndex::setEntries(std::vector<std::uint8_t> entries)
+{
+	assert(!isReady());
+	mEntries = std::move(entries);
+	mReady.store(true, std::memory_order_release);
+}
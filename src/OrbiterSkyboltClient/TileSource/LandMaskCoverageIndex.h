@@ -0,0 +1,56 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "LandMaskTile.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class TileWorkerPool;
+class ZTreeMgr;
+
+//! Classifies each tile of a land mask archive as all land, all water or mixed, so that uniform tiles can be answered without reading them.
+//! The archive is scanned once in the background, and the result is saved next to the archive for later sessions.
+class LandMaskCoverageIndex
+{
+public:
+	//! Loads the index saved next to the archive if it matches the archive, otherwise scans the archive on the worker pool and saves the result.
+	//! Coverage is unknown for all tiles until the scan is complete.
+	static std::shared_ptr<LandMaskCoverageIndex> loadOrScan(TileWorkerPool& workerPool, const std::shared_ptr<const ZTreeMgr>& treeMgr);
+
+	struct TileCoverage
+	{
+		LandMaskTile::Coverage coverage;
+		int tileSize; //!< Width and height of the tile in texels
+	};
+
+	//! @returns coverage of the tile with the given archive node index,
+	//! or nullopt if the node has no data, is not a square DXT1 tile, or the index is not ready yet
+	//!@ThreadSafe
+	std::optional<TileCoverage> getCoverage(std::uint32_t idx) const;
+
+	//!@ThreadSafe
+	bool isReady() const { return mReady.load(std::memory_order_acquire); }
+
+private:
+	//! Sets the entries and makes them visible to other threads
+	void setEntries(std::vector<std::uint8_t> entries);
+
+private:
+	//! One entry per archive node. Zero if coverage is unknown, otherwise the coverage and log2 of the tile size.
+	std::vector<std::uint8_t> mEntries;
+	std::atomic<bool> mReady = false;
+};
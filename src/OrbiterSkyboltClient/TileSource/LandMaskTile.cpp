@@ -0,0 +1,85 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "LandMaskTile.h"
+#include "DxtKernels.h"
+
+#include <assert.h>
+
+LandMaskTile::Coverage LandMaskTile::getDxt1Coverage(const std::uint8_t* data, int width, int height)
+{
+	assert(width % 4 == 0 && height % 4 == 0);
+	const int blockCount = (width / 4) * (height / 4);
+
+	std::uint16_t firstMask = getDxt1BlockTransparencyMask(data);
+	if (firstMask != 0 && firstMask != 0xFFFF)
+	{
+		return Coverage::Mixed;
+	}
+
+	for (int i = 1; i < blockCount; ++i)
+	{
+		if (getDxt1BlockTransparencyMask(data + i * dxt1BlockSizeBytes) != firstMask)
+		{
+			return Coverage::Mixed;
+		}
+	}
+	return (firstMask == 0) ? Coverage::Land : Coverage::Water;
+}
+
+LandMaskTile LandMaskTile::createUniform(int width, int height, Coverage coverage)
+{
+	assert(coverage != Coverage::Mixed);
+	LandMaskTile tile(width, height);
+	tile.mCoverage = coverage;
+	return tile;
+}
+
+LandMaskTile LandMaskTile::fromDxt1(const std::uint8_t* data, int width, int height)
+{
+	// Most tiles are entirely land or water, so check for uniform coverage before expanding to bits
+	Coverage coverage = getDxt1Coverage(data, width, height);
+	if (coverage != Coverage::Mixed)
+	{
+		return createUniform(width, height, coverage);
+	}
+
+	LandMaskTile tile(width, height);
+	const int blockCountX = width / 4;
+	const int blockCountY = height / 4;
+
+	tile.mWaterBits.resize((std::size_t(width) * height + 7) / 8, 0);
+	for (int by = 0; by < blockCountY; ++by)
+	{
+		for (int bx = 0; bx < blockCountX; ++bx)
+		{
+			std::uint16_t mask = getDxt1BlockTransparencyMask(data + (by * blockCountX + bx) * dxt1BlockSizeBytes);
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			for (int row = 0; row < 4; ++row)
+			{
+				int rowMask = (mask >> (row * 4)) & 0xF;
+				for (int column = 0; column < 4; ++column)
+				{
+					if (rowMask & (1 << column))
+					{
+						int i = (by * 4 + row) * width + bx * 4 + column;
+						tile.mWaterBits[i >> 3] |= std::uint8_t(1 << (i & 7));
+					}
+				}
+			}
+		}
+	}
+	return tile;
+}
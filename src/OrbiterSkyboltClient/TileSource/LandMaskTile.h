@@ -0,0 +1,69 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//! Land/water mask of a tile, with one bit per texel, or a single flag where the whole tile is land or water.
+//! Orbiter mask tiles mark water with zero alpha.
+class LandMaskTile
+{
+public:
+	enum class Coverage
+	{
+		Land,
+		Water,
+		Mixed
+	};
+
+	//! Creates a mask from the 1 bit alpha of DXT1 data, without decompressing.
+	//! @param width and height must be multiples of 4
+	static LandMaskTile fromDxt1(const std::uint8_t* data, int width, int height);
+
+	//! @returns coverage of DXT1 data without creating a mask
+	//! @param width and height must be multiples of 4
+	static Coverage getDxt1Coverage(const std::uint8_t* data, int width, int height);
+
+	//! @param coverage must be Land or Water
+	static LandMaskTile createUniform(int width, int height, Coverage coverage);
+
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+
+	Coverage getCoverage() const { return mCoverage; }
+
+	//! Rows are in the same order as the source data
+	bool isWater(int x, int y) const
+	{
+		if (mCoverage != Coverage::Mixed)
+		{
+			return mCoverage == Coverage::Water;
+		}
+		int i = y * mWidth + x;
+		return (mWaterBits[i >> 3] >> (i & 7)) & 1;
+	}
+
+	std::size_t getSizeBytes() const { return sizeof(*this) + mWaterBits.size(); }
+
+private:
+	LandMaskTile(int width, int height) : mWidth(width), mHeight(height) {}
+
+private:
+	int mWidth;
+	int mHeight;
+	Coverage mCoverage = Coverage::Mixed;
+	std::vector<std::uint8_t> mWaterBits; //!< One bit per texel in row major order, least significant bit first. Empty unless coverage is mixed.
+};
+
+using LandMaskTilePtr = std::shared_ptr<const LandMaskTile>;
@@ -10,6 +10,8 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 */
 
 #include "OrbiterElevationTileSource.h"
+#include "ElevationKernels.h"
+#include "TileGeometricError.h"
 #include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
 #include <SkyboltVis/Renderable/Planet/Tile/HeightMapElevationBounds.h>
 #include <SkyboltVis/Renderable/Planet/Tile/HeightMapElevationRerange.h>
@@ -17,12 +19,12 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <osgDB/Registry>
 #include <boost/scope_exit.hpp>
 
-using namespace skybolt;
+#include <algorithm>
+#include <assert.h>
+#include <climits>
+#include <cmath>
 
-OrbiterElevationTileSource::OrbiterElevationTileSource(const std::string& directory) :
-	OrbiterTileSource(std::make_unique<ZTreeMgr>(directory.c_str(), ZTreeMgr::LAYER_ELEV))
-{
-}
+using namespace skybolt;
 
 #pragma pack(push,1)
 //! From Orbiter developer documentation 'PlanetTextures.odt'
@@ -43,68 +45,537 @@ struct ELEVFILEHEADER { // file header for patch elevation data file
 };
 #pragma pack(pop)
 
-osg::ref_ptr<osg::Image> OrbiterElevationTileSource::createImage(const std::uint8_t* buffer, std::size_t sizeBytes) const
+static constexpr int sourceWidth = 259;
+static constexpr int sourceHeight = 259;
+static constexpr int tileWidth = 257;
+static constexpr int tileHeight = 257;
+static constexpr int elevationBias = 32768; //!< Added to raw values to store them in an unsigned texture
+static constexpr int paddingTexelCount = 2 * sourceWidth + 2 * tileHeight;
+
+static constexpr std::size_t cacheCapacity = 256;
+static constexpr std::size_t geometricErrorCacheCapacity = 16384; //!< About 1.5 MB
+
+constexpr double pi = 3.14159265358979323846;
+
+struct OrbiterElevationTileSource::NormalMaps
 {
-	if (sizeBytes < sizeof(ELEVFILEHEADER))
+	NormalMaps(double planetRadius) : planetRadius(planetRadius), cache(cacheCapacity) {}
+
+	ElevationNormalMapPtr generate(const QuadTreeTileKey& key, const DecodedElevationTile& tile)
 	{
-		return nullptr;
+		std::vector<std::uint16_t> paddedTexels(sourceWidth * sourceHeight);
+		tile.getPaddedTexels(paddedTexels.data());
+
+		const double tileSize = pi / (1 << key.level);
+		ElevationNormalMap::Geometry geometry;
+		geometry.southLatitude = pi / 2 - (key.y + 1) * tileSize;
+		geometry.cellSizeLatitude = tileSize / (tileHeight - 1);
+		geometry.cellSizeLongitude = tileSize / (tileWidth - 1);
+		geometry.planetRadius = planetRadius;
+		geometry.elevationScale = tile.scale;
+
+		auto normalMap = std::make_shared<ElevationNormalMap>(paddedTexels.data(), tileWidth, tileHeight, geometry);
+		cache.put(key, normalMap);
+		return normalMap;
 	}
 
-	const ELEVFILEHEADER& header = reinterpret_cast<const ELEVFILEHEADER&>(*buffer);
+	const double planetRadius;
+	TileCache<ElevationNormalMapPtr> cache;
+};
 
-	// Orbiter elevation tiles are 259x259 pixels. The inner 257x257 is a tile with edges along the lat lon bounds.
-	// We discard the outermost row and column, which is elevation data in the next adjacent tile.
-	osg::ref_ptr<osg::Image> image = new osg::Image();
-	image->allocateImage(257, 257, 1, GL_LUMINANCE, GL_UNSIGNED_SHORT);
-	image->setInternalTextureFormat(GL_R16);
-	uint16_t* ptr = (uint16_t*)image->getDataPointer();
+//! Combines inner texels with padding in the layout of DecodedElevationTile::paddingTexels into a (width + 2) x (height + 2) grid
+static void assemblePaddedTexels(const std::uint16_t* inner, int width, int height, const std::uint16_t* paddingTexels, std::uint16_t* out)
+{
+	const int paddedWidth = width + 2;
+	const std::uint16_t* south = paddingTexels;
+	const std::uint16_t* north = south + paddedWidth;
+	const std::uint16_t* west = north + paddedWidth;
+	const std::uint16_t* east = west + height;
 
-	constexpr int expectedWidth = 259;
-	constexpr int expectedHeight = 259;
-	if (header.xgrd != expectedWidth && header.ygrd != expectedHeight)
+	std::copy(south, south + paddedWidth, out);
+	for (int y = 0; y < height; ++y)
 	{
-		return nullptr;
+		std::uint16_t* row = out + (y + 1) * paddedWidth;
+		row[0] = west[y];
+		std::copy(inner + y * width, inner + (y + 1) * width, row + 1);
+		row[width + 1] = east[y];
 	}
+	std::copy(north, north + paddedWidth, out + (height + 1) * paddedWidth);
+}
 
-	if (header.dtype == 8) // uint8
+void DecodedElevationTile::getPaddedTexels(std::uint16_t* out) const
+{
+	assert(paddingTexels.getWidth() == 2 * (texels.getWidth() + 2) + 2 * texels.getHeight());
+	std::vector<std::uint16_t> inner(std::size_t(texels.getWidth()) * texels.getHeight());
+	texels.decode(inner.data());
+	std::vector<std::uint16_t> padding(paddingTexels.getWidth());
+	paddingTexels.decode(padding.data());
+	assemblePaddedTexels(inner.data(), texels.getWidth(), texels.getHeight(), padding.data(), out);
+}
+
+OrbiterElevationTileSource::OrbiterElevationTileSource(const std::string& directory) :
+	OrbiterTileSource(std::make_unique<ZTreeMgr>(directory.c_str(), ZTreeMgr::LAYER_ELEV)),
+	mModTreeMgr(std::make_unique<ZTreeMgr>(directory.c_str(), ZTreeMgr::LAYER_ELEVMOD)),
+	mCache(cacheCapacity),
+	mGeometricErrors(geometricErrorCacheCapacity)
+{
+	if (mModTreeMgr->TOC().size() == 0) // If load failed
 	{
-		if ((int)sizeBytes < header.hdrsize + expectedWidth * expectedHeight)
+		mModTreeMgr.reset();
+	}
+}
+
+OrbiterElevationTileSource::~OrbiterElevationTileSource() = default;
+
+static osg::ref_ptr<osg::Image> allocateElevationImage()
+{
+	osg::ref_ptr<osg::Image> image = new osg::Image();
+	image->allocateImage(tileWidth, tileHeight, 1, GL_LUMINANCE, GL_UNSIGNED_SHORT);
+	image->setInternalTextureFormat(GL_R16);
+	return image;
+}
+
+static void setElevationMetadata(osg::Image& image, const DecodedElevationTile& tile)
+{
+	vis::setHeightMapElevationBounds(image, vis::HeightMapElevationBounds(tile.minElevation, tile.maxElevation));
+	vis::setHeightMapElevationRerange(image, vis::HeightMapElevationRerange(tile.scale, tile.offset - elevationBias));
+	setTileGeometricError(image, tile.geometricError);
+}
+
+//! @returns max deviation in texel units of the texels from bilinear interpolation of the even numbered texels,
+//! which are the texels that the parent tile samples
+static double computeSubsampleDeviation(const std::uint16_t* texels, int width, int height)
+{
+	assert(width % 2 == 1 && height % 2 == 1);
+
+	// Deviations are accumulated with four times the precision to stay in integers
+	int maxDeviation4 = 0;
+	for (int y = 0; y < height; ++y)
+	{
+		const std::uint16_t* row = texels + y * width;
+		if (y % 2 == 0)
 		{
-			return nullptr;
+			// Odd texels on even rows lie between two parent texels
+			for (int x = 1; x < width; x += 2)
+			{
+				maxDeviation4 = std::max(maxDeviation4, 2 * std::abs(2 * int(row[x]) - int(row[x - 1]) - int(row[x + 1])));
+			}
 		}
+		else
+		{
+			const std::uint16_t* south = row - width;
+			const std::uint16_t* north = row + width;
+			for (int x = 0; x < width; x += 2)
+			{
+				maxDeviation4 = std::max(maxDeviation4, 2 * std::abs(2 * int(row[x]) - int(south[x]) - int(north[x])));
+			}
+			// Odd texels on odd rows lie between four parent texels
+			for (int x = 1; x < width; x += 2)
+			{
+				int corners = int(south[x - 1]) + int(south[x + 1]) + int(north[x - 1]) + int(north[x + 1]);
+				maxDeviation4 = std::max(maxDeviation4, std::abs(4 * int(row[x]) - corners));
+			}
+		}
+	}
+	return maxDeviation4 / 4.0;
+}
+
+static osg::ref_ptr<osg::Image> expandToImage(const DecodedElevationTile& tile)
+{
+	osg::ref_ptr<osg::Image> image = allocateElevationImage();
+	tile.texels.decode(reinterpret_cast<std::uint16_t*>(image->data()));
+	setElevationMetadata(*image, tile);
+	return image;
+}
+
+osg::ref_ptr<osg::Image> OrbiterElevationTileSource::createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const
+{
+	if (std::optional<DecodedElevationTilePtr> tile = mCache.get(key); tile)
+	{
+		getStats()->addCacheHit(key.level);
+		return expandToImage(**tile);
+	}
+	getStats()->addCacheMiss(key.level);
+
+	// Decoded tile is added to the cache by the decoder
+	return OrbiterTileSource::createImage(key, cancelSupplier);
+}
+
+DecodedElevationTilePtr OrbiterElevationTileSource::getCachedTile(const skybolt::QuadTreeTileKey& key) const
+{
+	std::optional<DecodedElevationTilePtr> tile = mCache.get(key);
+	return tile ? *tile : nullptr;
+}
 
-		const std::uint8_t* source = buffer + header.hdrsize;
-		for (int y = 1; y <= 257; ++y)
+DecodedElevationTilePtr OrbiterElevationTileSource::getTile(const skybolt::QuadTreeTileKey& key) const
+{
+	if (std::optional<DecodedElevationTilePtr> tile = mCache.get(key); tile)
+	{
+		return *tile;
+	}
+
+	// Decode straight to the compact tile, without expanding it to an image
+	std::vector<std::uint16_t> texels(tileWidth * tileHeight);
+	DecodedElevationTilePtr tile;
+	readNode(key, nullptr, ReadOrigin::Background, [&] (AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) {
+		tile = decodeTile(key, buffer, sizeBytes, texels.data());
+	});
+	return tile;
+}
+
+bool OrbiterElevationTileSource::hasAnyChildren(const skybolt::QuadTreeTileKey& key) const
+{
+	if (!OrbiterTileSource::hasAnyChildren(key))
+	{
+		return false;
+	}
+
+	if (mMinSplitGeometricError > 0)
+	{
+		// A child's geometric error is its deviation from this tile, so splitting is only worthwhile if some child exceeds the threshold.
+		// Missing children are served from this tile, so add no detail. Children which have not been decoded yet may add detail.
+		for (int dy = 0; dy < 2; ++dy)
 		{
-			for (int x = 1; x <= 257; ++x)
+			for (int dx = 0; dx < 2; ++dx)
 			{
-				*ptr++ = int(source[y * 259 + x]) + 32768;
+				QuadTreeTileKey childKey;
+				childKey.level = key.level + 1;
+				childKey.x = key.x * 2 + dx;
+				childKey.y = key.y * 2 + dy;
+
+				std::optional<QuadTreeTileKey> storedKey = getHighestStoredLevel(childKey);
+				if (storedKey && storedKey->level == childKey.level)
+				{
+					if (std::optional<double> error = mGeometricErrors.get(childKey); !error || *error >= mMinSplitGeometricError)
+					{
+						return true;
+					}
+				}
 			}
 		}
+		return false;
+	}
+	return true;
+}
+
+void OrbiterElevationTileSource::enableNormalMaps(double planetRadius)
+{
+	mNormalMaps = std::make_unique<NormalMaps>(planetRadius);
+}
+
+ElevationNormalMapPtr OrbiterElevationTileSource::getNormalMap(const skybolt::QuadTreeTileKey& key) const
+{
+	if (!mNormalMaps)
+	{
+		return nullptr;
+	}
+
+	if (std::optional<ElevationNormalMapPtr> normalMap = mNormalMaps->cache.get(key); normalMap)
+	{
+		return *normalMap;
+	}
+
+	if (DecodedElevationTilePtr tile = getTile(key); tile)
+	{
+		return mNormalMaps->generate(key, *tile);
+	}
+	return nullptr;
+}
+
+ElevationNormalMapPtr OrbiterElevationTileSource::getCachedNormalMap(const skybolt::QuadTreeTileKey& key) const
+{
+	if (!mNormalMaps)
+	{
+		return nullptr;
+	}
+	std::optional<ElevationNormalMapPtr> normalMap = mNormalMaps->cache.get(key);
+	return normalMap ? *normalMap : nullptr;
+}
+
+//! @returns the header if the buffer contains a valid elevation file, otherwise null
+static const ELEVFILEHEADER* getValidHeader(const std::uint8_t* buffer, std::size_t sizeBytes)
+{
+	if (sizeBytes < sizeof(ELEVFILEHEADER))
+	{
+		return nullptr;
+	}
+
+	const ELEVFILEHEADER* header = reinterpret_cast<const ELEVFILEHEADER*>(buffer);
+	std::size_t elementSize;
+	switch (header->dtype)
+	{
+		case 0: return header; // flat tiles have no data block
+		case 8: elementSize = sizeof(std::uint8_t); break;
+		case -16: elementSize = sizeof(std::int16_t); break;
+		default: return nullptr;
+	}
+
+	if (header->xgrd != sourceWidth || header->ygrd != sourceHeight)
+	{
+		return nullptr;
+	}
+
+	if (sizeBytes < std::size_t(header->hdrsize) + sourceWidth * sourceHeight * elementSize)
+	{
+		return nullptr;
+	}
+	return header;
+}
+
+//! Value used in elevation modification tiles to mark texels which are not modified
+template <typename T> constexpr T unmodifiedValue();
+template <> constexpr std::uint8_t unmodifiedValue<std::uint8_t>() { return UCHAR_MAX; }
+template <> constexpr std::int16_t unmodifiedValue<std::int16_t>() { return SHRT_MAX; }
+
+static std::uint16_t toTexel(int rawValue)
+{
+	return std::uint16_t(std::clamp(rawValue + elevationBias, 0, USHRT_MAX));
+}
+
+//! Maps raw values in a modification tile to raw values in the base tile's scale and offset
+struct ModRerange
+{
+	ModRerange(const ELEVFILEHEADER& base, const ELEVFILEHEADER& mod) :
+		scale(mod.scale / base.scale),
+		offset((mod.offset - base.offset) / base.scale)
+	{
+	}
+
+	int operator()(int modValue) const
+	{
+		return int(std::lround(modValue * scale + offset));
+	}
+
+	double scale;
+	double offset;
+};
+
+template <typename BaseT, typename ModT>
+static int mergeValue(BaseT baseValue, ModT modValue, const ModRerange& modRerange)
+{
+	return (modValue == unmodifiedValue<ModT>()) ? int(baseValue) : modRerange(modValue);
+}
+
+//! Copies the one texel border around the inner tile to paddingOut, in the layout of DecodedElevationTile::paddingTexels
+template <typename GetTexelFn>
+static void copyPadding(GetTexelFn getTexel, std::vector<std::uint16_t>& paddingOut)
+{
+	paddingOut.resize(paddingTexelCount);
+	std::uint16_t* out = paddingOut.data();
+	for (int y : {0, sourceHeight - 1})
+	{
+		for (int x = 0; x < sourceWidth; ++x)
+		{
+			*out++ = getTexel(x, y);
+		}
 	}
-	else if (header.dtype == -16) // int16
+	for (int x : {0, sourceWidth - 1})
 	{
-		if ((int)sizeBytes < header.hdrsize + expectedWidth * expectedHeight * sizeof(std::int16_t))
+		for (int y = 1; y <= tileHeight; ++y)
 		{
-			return nullptr;
+			*out++ = getTexel(x, y);
 		}
+	}
+}
 
-		const std::int16_t* source = reinterpret_cast<const std::int16_t*>(buffer + header.hdrsize);
-		for (int y = 1; y <= 257; ++y)
+//! Crops the inner tile from the source grid, converting to biased texels.
+//! Raw values of both source types always fit in a texel once biased, so no clamping is required.
+//! @param baseStride is the source row stride in elements, or zero to repeat the first row.
+template <typename BaseT>
+static void cropElevation(const BaseT* base, int baseStride, std::uint16_t* out, ElevationTexelBounds& boundsOut)
+{
+	for (int y = 1; y <= tileHeight; ++y)
+	{
+		biasElevationRow(base + y * baseStride + 1, out, tileWidth, boundsOut);
+		out += tileWidth;
+	}
+}
+
+//! Same as cropElevation() but with modified texels replacing base texels in the same pass
+template <typename BaseT, typename ModT>
+static void cropAndMergeElevation(const BaseT* base, int baseStride, const ModT* mod, const ModRerange& modRerange, std::uint16_t* out, ElevationTexelBounds& boundsOut)
+{
+	for (int y = 1; y <= tileHeight; ++y)
+	{
+		const BaseT* baseRow = base + y * baseStride;
+		const ModT* modRow = mod + y * sourceWidth;
+		for (int x = 1; x <= tileWidth; ++x)
 		{
-			for (int x = 1; x <= 257; ++x)
-			{
-				*ptr++ = int(source[y * 259 + x]) + 32768;;
-			}
+			*out = toTexel(mergeValue(baseRow[x], modRow[x], modRerange));
+			boundsOut.add(*out++);
 		}
 	}
-	else // if (header.dtype == 0) // flat
+}
+
+//! Same as cropElevation() but copies the padding instead of the inner tile
+template <typename BaseT>
+static void copyElevationPadding(const BaseT* base, int baseStride, std::vector<std::uint16_t>& paddingOut)
+{
+	copyPadding([&](int x, int y) { return toTexel(int(base[y * baseStride + x])); }, paddingOut);
+}
+
+//! Same as cropAndMergeElevation() but copies the padding instead of the inner tile
+template <typename BaseT, typename ModT>
+static void copyAndMergeElevationPadding(const BaseT* base, int baseStride, const ModT* mod, const ModRerange& modRerange, std::vector<std::uint16_t>& paddingOut)
+{
+	copyPadding([&](int x, int y) { return toTexel(mergeValue(base[y * baseStride + x], mod[y * sourceWidth + x], modRerange)); }, paddingOut);
+}
+
+//! Applies filters to the decoded texels and padding, updating bounds if the filters modify the tile
+static void filterElevation(const ElevationFilterChain& filters, const QuadTreeTileKey& key, const ELEVFILEHEADER& header,
+	std::uint16_t* texels, std::vector<std::uint16_t>& paddingTexels, ElevationTexelBounds& boundsInOut)
+{
+	// Filters see raw values including the padding, so that edits along tile edges match adjacent tiles.
+	// Texels are raw values biased by 32768, so every texel maps back to a raw int16 value.
+	std::vector<std::uint16_t> paddedTexels(sourceWidth * sourceHeight);
+	assemblePaddedTexels(texels, tileWidth, tileHeight, paddingTexels.data(), paddedTexels.data());
+
+	std::vector<std::int16_t> values(paddedTexels.size());
+	std::transform(paddedTexels.begin(), paddedTexels.end(), values.begin(), [](std::uint16_t texel) {
+		return std::int16_t(int(texel) - elevationBias);
+	});
+
+	ElevationFilterGrid grid;
+	grid.values = values.data();
+	grid.width = sourceWidth;
+	grid.height = sourceHeight;
+	grid.scale = header.scale;
+	grid.offset = header.offset;
+	ElevationFilterChain::getTileBounds(key, grid);
+
+	if (!filters.apply(key, grid))
+	{
+		return;
+	}
+
+	boundsInOut = ElevationTexelBounds();
+	cropElevation(values.data(), sourceWidth, texels, boundsInOut);
+	copyElevationPadding(values.data(), sourceWidth, paddingTexels);
+}
+
+template <typename BaseT>
+static void decodeElevation(const BaseT* base, int baseStride, const ELEVFILEHEADER& baseHeader, const std::uint8_t* modBuffer, std::uint16_t* out,
+	ElevationTexelBounds& boundsOut, std::vector<std::uint16_t>& paddingOut)
+{
+	if (!modBuffer)
 	{
-		memset(ptr, 0, 257 * 257 * sizeof(std::uint16_t));
+		cropElevation(base, baseStride, out, boundsOut);
+		copyElevationPadding(base, baseStride, paddingOut);
+		return;
 	}
 
-	vis::setHeightMapElevationBounds(*image, vis::HeightMapElevationBounds(header.emin, header.emax));
-	vis::setHeightMapElevationRerange(*image, vis::HeightMapElevationRerange(header.scale, header.offset - 32768));
+	const ELEVFILEHEADER& modHeader = reinterpret_cast<const ELEVFILEHEADER&>(*modBuffer);
+	const std::uint8_t* modData = modBuffer + modHeader.hdrsize;
+	ModRerange modRerange(baseHeader, modHeader);
 
+	if (modHeader.dtype == 8)
+	{
+		cropAndMergeElevation(base, baseStride, modData, modRerange, out, boundsOut);
+		copyAndMergeElevationPadding(base, baseStride, modData, modRerange, paddingOut);
+	}
+	else if (modHeader.dtype == -16)
+	{
+		const std::int16_t* modData16 = reinterpret_cast<const std::int16_t*>(modData);
+		cropAndMergeElevation(base, baseStride, modData16, modRerange, out, boundsOut);
+		copyAndMergeElevationPadding(base, baseStride, modData16, modRerange, paddingOut);
+	}
+	else // flat mod tiles carry no modifications
+	{
+		cropElevation(base, baseStride, out, boundsOut);
+		copyElevationPadding(base, baseStride, paddingOut);
+	}
+}
+
+osg::ref_ptr<osg::Image> OrbiterElevationTileSource::createImage(const skybolt::QuadTreeTileKey& key, AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) const
+{
+	osg::ref_ptr<osg::Image> image = allocateElevationImage();
+	DecodedElevationTilePtr tile = decodeTile(key, buffer, sizeBytes, reinterpret_cast<std::uint16_t*>(image->data()));
+	if (!tile)
+	{
+		return nullptr;
+	}
+
+	setElevationMetadata(*image, *tile);
 	return image;
 }
+
+DecodedElevationTilePtr OrbiterElevationTileSource::decodeTile(const skybolt::QuadTreeTileKey& key, const AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes, std::uint16_t* texelsOut) const
+{
+	const ELEVFILEHEADER* header = getValidHeader(buffer.data(), sizeBytes);
+	if (!header)
+	{
+		return nullptr;
+	}
+
+	// Most tiles have no modifications, so check the index before locking and reading the mod archive.
+	// The index is immutable after the archive is opened, so can be accessed without locking.
+	BYTE* modBuf = nullptr;
+	DWORD modSize = 0;
+	if (mModTreeMgr)
+	{
+		DWORD idx = mModTreeMgr->Idx(key.level + orbiterLevelZeroOffset, key.y, key.x);
+		if (idx != (DWORD)-1 && mModTreeMgr->NodeSizeInflated(idx) != 0)
+		{
+			std::scoped_lock<std::mutex> lock(mModTreeMgrMutex);
+			modSize = mModTreeMgr->ReadData(idx, &modBuf);
+		}
+	}
+
+	BOOST_SCOPE_EXIT(&mModTreeMgr, &modBuf)
+	{
+		if (modBuf)
+		{
+			mModTreeMgr->ReleaseData(modBuf);
+		}
+	} BOOST_SCOPE_EXIT_END
+
+	const std::uint8_t* modBuffer = getValidHeader(modBuf, modSize) ? modBuf : nullptr;
+
+	// Orbiter elevation tiles are 259x259 pixels. The inner 257x257 is a tile with edges along the lat lon bounds.
+	// The outermost row and column is elevation data in the next adjacent tile. It is not part of the image,
+	// but is kept with the decoded tile for computing derivatives on the tile's edges.
+	std::uint16_t* ptr = texelsOut;
+
+	// Bounds are computed from the decoded texels because header bounds are unreliable in some third party archives
+	ElevationTexelBounds texelBounds;
+	std::vector<std::uint16_t> paddingTexels;
+	const std::uint8_t* source = buffer.data() + header->hdrsize;
+	if (header->dtype == 8) // uint8
+	{
+		decodeElevation(source, sourceWidth, *header, modBuffer, ptr, texelBounds, paddingTexels);
+	}
+	else if (header->dtype == -16) // int16
+	{
+		decodeElevation(reinterpret_cast<const std::int16_t*>(source), sourceWidth, *header, modBuffer, ptr, texelBounds, paddingTexels);
+	}
+	else // flat, with every raw value equal to zero
+	{
+		static const std::int16_t flatRow[sourceWidth] = {};
+		decodeElevation(flatRow, 0, *header, modBuffer, ptr, texelBounds, paddingTexels);
+	}
+
+	if (mFilters && !mFilters->isEmpty())
+	{
+		filterElevation(*mFilters, key, *header, ptr, paddingTexels, texelBounds);
+	}
+
+	ElevationTexelBounds paddingBounds;
+	for (std::uint16_t texel : paddingTexels)
+	{
+		paddingBounds.add(texel);
+	}
+
+	// Per-block bounds of constant tiles would all be equal, so a uniform pyramid saves building and storing them
+	const bool constant = (texelBounds.min == texelBounds.max);
+	auto tile = std::make_shared<DecodedElevationTile>(DecodedElevationTile{
+		CompactElevationTile(ptr, tileWidth, tileHeight, texelBounds),
+		constant ? ElevationMinMaxPyramid(texelBounds, tileWidth, tileHeight) : ElevationMinMaxPyramid(ptr, tileWidth, tileHeight),
+		CompactElevationTile(paddingTexels.data(), paddingTexelCount, 1, paddingBounds),
+		0, 0, header->scale, header->offset,
+		constant ? 0.0 : computeSubsampleDeviation(ptr, tileWidth, tileHeight) * std::abs(header->scale)
+	});
+	tile->toElevationBounds(texelBounds, tile->minElevation, tile->maxElevation);
+	mCache.put(key, tile);
+	mGeometricErrors.put(key, tile->geometricError);
+	return tile;
+}
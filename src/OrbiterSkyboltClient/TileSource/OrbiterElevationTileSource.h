@@ -11,16 +11,119 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #pragma once
 
+#include "CompactElevationTile.h"
+#include "ElevationFilter.h"
+#include "ElevationMinMaxPyramid.h"
+#include "ElevationNormalMap.h"
 #include "OrbiterTileSource.h"
+#include "TileCache.h"
 
+//! Decoded elevation tile, with modifications applied
+struct DecodedElevationTile
+{
+	CompactElevationTile texels; //!< Raw values biased by 32768
+	ElevationMinMaxPyramid texelBoundsPyramid; //!< Uniform if the texels are constant
+
+	//! Biased texels of the one texel border around the tile, which lie in adjacent tiles, as a single row.
+	//! Stored as the south row and north row including corners, followed by the west and east columns excluding corners.
+	CompactElevationTile paddingTexels;
+
+	double minElevation;
+	double maxElevation;
+	double scale; //!< Elevation = raw value * scale + offset
+	double offset;
+
+	//! Max deviation in meters of the texels from the bilinear approximation given by the parent tile, which has half the resolution
+	double geometricError;
+
+	double toElevation(std::uint16_t texel) const { return (int(texel) - 32768) * scale + offset; }
+
+	//! Converts texel bounds to elevation bounds
+	void toElevationBounds(const ElevationTexelBounds& texelBounds, double& minOut, double& maxOut) const
+	{
+		minOut = toElevation(texelBounds.min);
+		maxOut = toElevation(texelBounds.max);
+		if (minOut > maxOut) // If scale is negative
+		{
+			std::swap(minOut, maxOut);
+		}
+	}
+
+	//! Writes texels including padding to out, which must have (width + 2) x (height + 2) elements
+	void getPaddedTexels(std::uint16_t* out) const;
+};
+
+using DecodedElevationTilePtr = std::shared_ptr<const DecodedElevationTile>;
+
+//! Reads elevation tiles from the planet's Elev archive, with modifications from the Elev_mod archive applied on top.
 class OrbiterElevationTileSource : public OrbiterTileSource
 {
 public:
 	OrbiterElevationTileSource(const std::string& directory);
-	~OrbiterElevationTileSource() override = default;
+	~OrbiterElevationTileSource() override;
+
+	//!@ThreadSafe
+	osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const override;
+
+	//! @returns false if none of the tile's children add more detail over it than the split threshold.
+	//! Never reads tiles. Children whose geometric error is not yet known are assumed to add detail, so the tile splits,
+	//! and loading the children records their errors for later calls.
+	//!@ThreadSafe
+	bool hasAnyChildren(const skybolt::QuadTreeTileKey& key) const override;
+
+	const std::string& getCacheSha() const override { static std::string s = "OrbiterElevationTileSourceWithMods"; return s; }
 
-	const std::string& getCacheSha() const override { static std::string s = "OrbiterElevationTileSource"; return s; }
+	//! Sets filters applied to tiles as they are decoded. Filtered tiles are cached, so filters run once per decode rather than per request.
+	void setElevationFilters(const ElevationFilterChainPtr& filters) { mFilters = filters; }
+
+	//! Sets the geometric error in meters of children below which tiles are not split. Zero disables the check.
+	//! @see DecodedElevationTile::geometricError
+	void setMinSplitGeometricError(double error) { mMinSplitGeometricError = error; }
+
+	//! @returns the decoded tile, reading it if it is not cached, or null if the tile is not available.
+	//! Provides bounds and texels for consumers such as culling and height queries which don't need an image.
+	//!@ThreadSafe
+	DecodedElevationTilePtr getTile(const skybolt::QuadTreeTileKey& key) const;
+
+	//! @returns the decoded tile if it is cached, otherwise null
+	//!@ThreadSafe
+	DecodedElevationTilePtr getCachedTile(const skybolt::QuadTreeTileKey& key) const;
+
+	//! Enables normal maps, which are generated on the first getNormalMap() call for a tile and cached.
+	//! Nothing requests normal maps yet, so enabling them costs nothing until a consumer such as the terrain shader uses them.
+	void enableNormalMaps(double planetRadius);
+
+	//! @returns the tile's normal map, generating it on the calling thread if it is not cached.
+	//! Returns null if the tile is not available or normal maps are not enabled.
+	//!@ThreadSafe
+	ElevationNormalMapPtr getNormalMap(const skybolt::QuadTreeTileKey& key) const;
+
+	//! @returns the tile's normal map if it is cached, otherwise null
+	//!@ThreadSafe
+	ElevationNormalMapPtr getCachedNormalMap(const skybolt::QuadTreeTileKey& key) const;
 
 protected:
-	osg::ref_ptr<osg::Image> createImage(const std::uint8_t* buffer, std::size_t sizeBytes) const;
+	osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) const override;
+
+private:
+	std::unique_ptr<ZTreeMgr> mModTreeMgr; //!< Null if the planet has no elevation modifications
+	mutable std::mutex mModTreeMgrMutex;
+
+	//! Caches merged tiles so that the base and mod tiles are not read and merged again on each request.
+	//! Tiles are cached in compact form and expanded to images on request.
+	mutable TileCache<DecodedElevationTilePtr> mCache;
+
+	double mMinSplitGeometricError = 0;
+
+	//! Geometric error of recently decoded tiles. Holds many more tiles than mCache, so that split decisions
+	//! outlive the decoded tiles and don't depend on which tiles are cached.
+	mutable TileCache<double> mGeometricErrors;
+
+	//! Decodes the tile into texelsOut, which must have room for tileWidth x tileHeight texels, and caches the decoded tile.
+	//! @returns the decoded tile, or null if the data is not a valid elevation tile
+	DecodedElevationTilePtr decodeTile(const skybolt::QuadTreeTileKey& key, const AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes, std::uint16_t* texelsOut) const;
+	ElevationFilterChainPtr mFilters; //!< May be null
+
+	struct NormalMaps;
+	std::unique_ptr<NormalMaps> mNormalMaps; //!< Null if normal maps are not enabled
 };
\ No newline at end of file
@@ -10,26 +10,319 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 */
 
 #include "OrbiterImageTileSource.h"
+#include "DdsImage.h"
+#include "DxtKernels.h"
+#include "LandMaskCoverageIndex.h"
 #include "MemoryStreamBuf.h"
+#include "TileWorkerPool.h"
 #include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
 
 #include <osgDB/Registry>
 #include <boost/scope_exit.hpp>
 
+#include <algorithm>
+
+static ZTreeMgr::Layer toTreeLayer(OrbiterImageTileSource::LayerType layerType)
+{
+	switch (layerType)
+	{
+		case OrbiterImageTileSource::LayerType::Albedo: return ZTreeMgr::LAYER_SURF;
+		case OrbiterImageTileSource::LayerType::LandMask: return ZTreeMgr::LAYER_MASK;
+	}
+	assert(!"Should not get here");
+	return ZTreeMgr::LAYER_SURF;
+}
+
+//! @returns a single texel image standing in for a tile which is entirely land or water
+static osg::ref_ptr<osg::Image> createUniformLandMaskImage(LandMaskTile::Coverage coverage)
+{
+	osg::ref_ptr<osg::Image> image = new osg::Image();
+	image->allocateImage(1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+	image->setInternalTextureFormat(GL_RGBA8);
+	std::uint8_t* texel = image->data();
+	texel[0] = texel[1] = texel[2] = 0;
+	texel[3] = (coverage == LandMaskTile::Coverage::Water) ? 0 : 255;
+	return image;
+}
+
+static constexpr std::size_t landMaskCacheCapacity = 1024;
+
+// Images decoded ahead of their request are normally fetched shortly after the image they were decoded with,
+// so only need to be held for as many tiles as may be in flight.
+static constexpr std::size_t prefetchedImageCacheCapacity = 64;
+
 OrbiterImageTileSource::OrbiterImageTileSource(const std::string& directory, const LayerType& layerType) :
-	OrbiterTileSource(std::make_unique<ZTreeMgr>(directory.c_str(), layerType == LayerType::LandMask ? ZTreeMgr::LAYER_MASK : ZTreeMgr::LAYER_SURF)),
-	mInterpretTextureAsDxt1Rgba(layerType == LayerType::LandMask)
+	OrbiterTileSource(std::make_unique<ZTreeMgr>(directory.c_str(), toTreeLayer(layerType))),
+	mInterpretTextureAsDxt1Rgba(layerType == LayerType::LandMask),
+	mLandMaskCache(layerType == LayerType::LandMask ? landMaskCacheCapacity : 0),
+	mPrefetchedImageCache(prefetchedImageCacheCapacity)
+{
+}
+
+void OrbiterImageTileSource::coSchedule(const std::shared_ptr<OrbiterImageTileSource>& a, const std::shared_ptr<OrbiterImageTileSource>& b,
+	const std::shared_ptr<TileWorkerPool>& workerPool)
+{
+	assert(a != b);
+	assert(workerPool);
+	{
+		std::scoped_lock<std::mutex> lock(a->mCoScheduledSourceMutex);
+		a->mCoScheduledSource = b;
+		a->mCoScheduleWorkerPool = workerPool;
+	}
+	{
+		std::scoped_lock<std::mutex> lock(b->mCoScheduledSourceMutex);
+		b->mCoScheduledSource = a;
+		b->mCoScheduleWorkerPool = workerPool;
+	}
+}
+
+osg::ref_ptr<osg::Image> OrbiterImageTileSource::createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const
+{
+	if (std::optional<osg::ref_ptr<osg::Image>> image = mPrefetchedImageCache.take(key); image)
+	{
+		return *image;
+	}
+
+	if (mCompactUniformLandMask)
+	{
+		if (std::optional<LandMaskCoverageIndex::TileCoverage> coverage = getUniformTileCoverage(key); coverage)
+		{
+			return createUniformLandMaskImage(coverage->coverage);
+		}
+	}
+
+	claimPendingPrefetch(key);
+	osg::ref_ptr<osg::Image> image = OrbiterTileSource::createImage(key, cancelSupplier);
+	if (image)
+	{
+		// Decode the co-scheduled source's tile on the worker pool, so that this request is not delayed by a second read
+		std::shared_ptr<const OrbiterImageTileSource> coScheduledSource;
+		std::shared_ptr<TileWorkerPool> workerPool;
+		{
+			std::scoped_lock<std::mutex> lock(mCoScheduledSourceMutex);
+			coScheduledSource = mCoScheduledSource.lock();
+			workerPool = mCoScheduleWorkerPool.lock();
+		}
+		if (coScheduledSource && workerPool)
+		{
+			schedulePrefetch(coScheduledSource, *workerPool, key, std::move(cancelSupplier));
+		}
+	}
+	return image;
+}
+
+void OrbiterImageTileSource::schedulePrefetch(const std::shared_ptr<const OrbiterImageTileSource>& source, TileWorkerPool& workerPool,
+	const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier)
+{
+	if (source->mPrefetchedImageCache.get(key))
+	{
+		return;
+	}
+
+	{
+		std::scoped_lock<std::mutex> lock(source->mPendingPrefetchesMutex);
+		if (!source->mPendingPrefetches.insert(toTileCacheKey(key)).second)
+		{
+			return;
+		}
+	}
+
+	workerPool.submit([source, key, cancelSupplier = std::move(cancelSupplier)] {
+		source->prefetch(key, cancelSupplier);
+	});
+}
+
+void OrbiterImageTileSource::claimPendingPrefetch(const skybolt::QuadTreeTileKey& key) const
+{
+	std::scoped_lock<std::mutex> lock(mPendingPrefetchesMutex);
+	mPendingPrefetches.erase(toTileCacheKey(key));
+}
+
+void OrbiterImageTileSource::prefetch(const skybolt::QuadTreeTileKey& key, const std::function<bool()>& cancelSupplier) const
+{
+	// Skip the prefetch if a request claimed the tile while the prefetch was queued
+	{
+		std::scoped_lock<std::mutex> lock(mPendingPrefetchesMutex);
+		if (mPendingPrefetches.erase(toTileCacheKey(key)) == 0)
+		{
+			return;
+		}
+	}
+
+	if ((cancelSupplier && cancelSupplier()) || mPrefetchedImageCache.get(key))
+	{
+		return;
+	}
+
+	// Don't read tiles which will be answered from the coverage index
+	if (mCompactUniformLandMask && getUniformTileCoverage(key))
+	{
+		return;
+	}
+
+	if (osg::ref_ptr<osg::Image> image = readImage(key, cancelSupplier, ReadOrigin::Background); image)
+	{
+		mPrefetchedImageCache.put(key, image);
+	}
+}
+
+void OrbiterImageTileSource::enableCoverageIndex(TileWorkerPool& workerPool)
+{
+	if (mInterpretTextureAsDxt1Rgba && getTreeMgr())
+	{
+		mCoverageIndex = LandMaskCoverageIndex::loadOrScan(workerPool, getTreeMgr());
+	}
+}
+
+std::optional<LandMaskTile::Coverage> OrbiterImageTileSource::getIndexedCoverage(const skybolt::QuadTreeTileKey& key) const
 {
+	if (!mCoverageIndex)
+	{
+		return std::nullopt;
+	}
+
+	std::optional<LandMaskCoverageIndex::TileCoverage> coverage = mCoverageIndex->getCoverage(getNodeIndex(key));
+	return coverage ? std::optional<LandMaskTile::Coverage>(coverage->coverage) : std::nullopt;
+}
+
+std::optional<LandMaskCoverageIndex::TileCoverage> OrbiterImageTileSource::getUniformTileCoverage(const skybolt::QuadTreeTileKey& key) const
+{
+	if (!mCoverageIndex)
+	{
+		return std::nullopt;
+	}
+
+	std::optional<LandMaskCoverageIndex::TileCoverage> coverage = mCoverageIndex->getCoverage(getNodeIndex(key));
+	if (coverage && coverage->coverage != LandMaskTile::Coverage::Mixed)
+	{
+		return coverage;
+	}
+	return std::nullopt;
+}
+
+//! @returns the land mask of DDS mask tile data, or null if the data is not a single level DXT1 image of whole blocks.
+//! Flips the data in place, so that mask rows are in the same order as the flipped mask images.
+static LandMaskTilePtr decodeLandMask(std::uint8_t* data, std::size_t sizeBytes)
+{
+	std::optional<Dxt1DdsLayout> layout = getDxt1DdsLayout(data, sizeBytes);
+	if (!layout || layout->width % 4 != 0 || layout->height % 4 != 0)
+	{
+		return nullptr;
+	}
+
+	std::uint8_t* blocks = data + layout->dataOffset;
+	flipDxt1Vertical(blocks, layout->width, layout->height);
+	return std::make_shared<LandMaskTile>(LandMaskTile::fromDxt1(blocks, layout->width, layout->height));
+}
+
+LandMaskTilePtr OrbiterImageTileSource::getCachedLandMask(const skybolt::QuadTreeTileKey& key) const
+{
+	std::optional<LandMaskTilePtr> mask = mLandMaskCache.get(key);
+	return mask ? *mask : nullptr;
+}
+
+LandMaskTilePtr OrbiterImageTileSource::getLandMask(const skybolt::QuadTreeTileKey& key) const
+{
+	if (std::optional<LandMaskTilePtr> mask = mLandMaskCache.get(key); mask)
+	{
+		return *mask;
+	}
+
+	if (std::optional<LandMaskCoverageIndex::TileCoverage> coverage = getUniformTileCoverage(key); coverage)
+	{
+		return std::make_shared<LandMaskTile>(LandMaskTile::createUniform(coverage->tileSize, coverage->tileSize, coverage->coverage));
+	}
+
+	if (!mInterpretTextureAsDxt1Rgba)
+	{
+		return nullptr;
+	}
+
+	// Decode straight to the mask, without creating an image
+	LandMaskTilePtr mask;
+	readNode(key, nullptr, ReadOrigin::Background, [&] (AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) {
+		mask = decodeLandMask(buffer.data(), sizeBytes);
+	});
+	if (mask)
+	{
+		mLandMaskCache.put(key, mask);
+	}
+	return mask;
+}
+
+static bool isDxt1(GLenum pixelFormat)
+{
+	return pixelFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || pixelFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+}
+
+//! @returns true if the image consists of whole DXT1 blocks, which can be processed without decompressing
+static bool isWholeBlockDxt1(const osg::Image& image)
+{
+	return isDxt1(image.getPixelFormat()) && !image.isMipmap() && image.r() == 1 && image.s() % 4 == 0 && image.t() % 4 == 0;
+}
+
+static void flipVertical(osg::Image& image)
+{
+	// Flip DXT1 tiles in the compressed domain, avoiding the copy made by osg::Image::flipVertical()
+	if (isWholeBlockDxt1(image))
+	{
+		flipDxt1Vertical(image.data(), image.s(), image.t());
+		image.dirty();
+	}
+	else
+	{
+		image.flipVertical();
+	}
+}
+
+//! Generates a full mip chain for a single level DXT1 image, writing the levels after the base level in the image's own buffer.
+//! @returns false if the buffer has no room for the chain, in which case the image is unchanged
+static bool appendDxt1MipChain(osg::Image& image)
+{
+	int width = image.s();
+	int height = image.t();
+	if (getWrappedDxt1ImageCapacity(image) < getDxt1MipChainSizeBytes(width, height))
+	{
+		return false;
+	}
+
+	std::uint8_t* data = image.data();
+	osg::Image::MipmapDataType mipmapOffsets;
+	std::size_t offset = 0;
+	while (width > 1 || height > 1)
+	{
+		std::size_t nextOffset = offset + getDxt1ImageSizeBytes(width, height);
+		downsampleDxt1(data + offset, width, height, data + nextOffset);
+		mipmapOffsets.push_back(unsigned(nextOffset));
+
+		offset = nextOffset;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	image.setMipmapLevels(mipmapOffsets);
+	image.dirty();
+	return true;
 }
 
-osg::ref_ptr<osg::Image> OrbiterImageTileSource::createImage(const std::uint8_t* buffer, std::size_t sizeBytes) const
+static osg::ref_ptr<osg::Image> readDdsImage(const std::uint8_t* buffer, std::size_t sizeBytes)
 {
 	MemoryStreamBuf membuf((char*)(buffer), sizeBytes);
 	std::istream istream(&membuf);
 
 	osgDB::ReaderWriter *rw = osgDB::Registry::instance()->getReaderWriterForExtension("dds");
 	osgDB::ReaderWriter::ReadResult res = rw->readImage(istream);
-	osg::ref_ptr<osg::Image> image = res.getImage();
+	return res.getImage();
+}
+
+osg::ref_ptr<osg::Image> OrbiterImageTileSource::createImage(const skybolt::QuadTreeTileKey& key, AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) const
+{
+	// Orbiter surface and mask tiles are DXT1, which are wrapped without copying. Other formats go through the osgDB reader.
+	osg::ref_ptr<osg::Image> image = wrapDxt1DdsImage(buffer, sizeBytes);
+	if (!image)
+	{
+		image = readDdsImage(buffer.data(), sizeBytes);
+	}
 
 	if (image)
 	{
@@ -42,8 +335,36 @@ osg::ref_ptr<osg::Image> OrbiterImageTileSource::createImage(const std::uint8_t*
 			image->setPixelFormat(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT);
 		}
 
-		image->flipVertical();
+		flipVertical(*image);
+
+		// Mip levels are generated opaque, so are not generated for mask tiles whose alpha would be lost
+		if (mGenerateMipmaps && !mInterpretTextureAsDxt1Rgba && isWholeBlockDxt1(*image))
+		{
+			appendDxt1MipChain(*image);
+		}
+
+		// Only coverage is needed here, which is found without building a mask
+		if (mInterpretTextureAsDxt1Rgba && mCompactUniformLandMask && isWholeBlockDxt1(*image))
+		{
+			if (LandMaskTile::Coverage coverage = LandMaskTile::getDxt1Coverage(image->data(), image->s(), image->t()); coverage != LandMaskTile::Coverage::Mixed)
+			{
+				return createUniformLandMaskImage(coverage);
+			}
+		}
 	}
 
 	return image;
-}
\ No newline at end of file
+}
+
+std::size_t OrbiterImageTileSource::getInflateBufferCapacity(std::size_t sizeBytes) const
+{
+	// Reserve room to generate the mip chain in place
+	if (mGenerateMipmaps && !mInterpretTextureAsDxt1Rgba)
+	{
+		if (std::optional<std::size_t> mipmappedSizeBytes = getSquareDxt1DdsSizeWithMipChain(sizeBytes); mipmappedSizeBytes)
+		{
+			return *mipmappedSizeBytes;
+		}
+	}
+	return sizeBytes;
+}
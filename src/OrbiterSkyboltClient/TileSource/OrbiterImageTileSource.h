@@ -11,7 +11,13 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #pragma once
 
+#include "LandMaskCoverageIndex.h"
+#include "LandMaskTile.h"
 #include "OrbiterTileSource.h"
+#include "TileCache.h"
+
+#include <mutex>
+#include <unordered_set>
 
 class OrbiterImageTileSource : public OrbiterTileSource
 {
@@ -25,9 +31,82 @@ public:
 	OrbiterImageTileSource(const std::string& directory, const LayerType& layerType);
 	~OrbiterImageTileSource() override = default;
 
+	//! If enabled, land mask tiles which are entirely land or water are returned as single texel images rather than full tiles.
+	//! Must be called before the source is used.
+	void setCompactUniformLandMask(bool enabled) { mCompactUniformLandMask = enabled; }
+
+	//! If enabled, a full mip chain is generated for DXT1 tiles as they are decoded, since mipmaps can't be generated on the GPU
+	//! for compressed textures. The chain is written into the tile's inflate buffer, which is sized for it, so only square tiles
+	//! get mipmaps. Orbiter archives only contain square tiles. Has no effect on land mask tiles.
+	//! The chain is generated inline on the decoding thread, which is the loader thread for requested tiles,
+	//! and again on every decode of a tile, since decoded images are not cached.
+	//! Must be called before the source is used.
+	void setGenerateMipmaps(bool enabled) { mGenerateMipmaps = enabled; }
+
+	//! @returns the tile's land mask, reading it if it is not cached, or null if the tile is not available or this is not a land mask source.
+	//! Masks are only built for this call, so sources whose masks are never queried don't spend memory on them.
+	//!@ThreadSafe
+	LandMaskTilePtr getLandMask(const skybolt::QuadTreeTileKey& key) const;
+
+	//! @returns the tile's land mask if it is cached, otherwise null
+	//!@ThreadSafe
+	LandMaskTilePtr getCachedLandMask(const skybolt::QuadTreeTileKey& key) const;
+
+	//! Classifies the land mask archive's tiles as all land, all water or mixed, loading the classification saved next to the archive
+	//! or scanning the archive on the worker pool. Once the classification is ready, uniform tiles are answered without reading the archive
+	//! where possible. Has no effect if this is not a land mask source.
+	//! Must be called before the source is used.
+	void enableCoverageIndex(TileWorkerPool& workerPool);
+
+	//! @returns coverage of the tile if known without reading it, otherwise nullopt
+	//!@ThreadSafe
+	std::optional<LandMaskTile::Coverage> getIndexedCoverage(const skybolt::QuadTreeTileKey& key) const;
+
+	//! Co-schedules two sources with the same tiling, such as a planet's albedo and land mask sources.
+	//! When either source decodes a requested tile, the other's tile with the same key is read and decoded on the worker pool,
+	//! and held until requested. The prefetch is skipped if the request is cancelled or the tile is requested before the prefetch starts.
+	//! The request's cancel supplier is copied to the prefetch task, so must remain callable after the request returns.
+	//!@ThreadSafe
+	static void coSchedule(const std::shared_ptr<OrbiterImageTileSource>& a, const std::shared_ptr<OrbiterImageTileSource>& b,
+		const std::shared_ptr<TileWorkerPool>& workerPool);
+
+	//!@ThreadSafe
+	osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const override;
+
 protected:
-	osg::ref_ptr<osg::Image> createImage(const std::uint8_t* buffer, std::size_t sizeBytes) const;
+	osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) const override;
+	std::size_t getInflateBufferCapacity(std::size_t sizeBytes) const override;
+
+private:
+	//! Queues prefetch() of the tile on the worker pool
+	static void schedulePrefetch(const std::shared_ptr<const OrbiterImageTileSource>& source, TileWorkerPool& workerPool,
+		const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier);
+
+	//! Decodes the tile into the prefetched image cache if the prefetch is still pending and the tile is not already there
+	void prefetch(const skybolt::QuadTreeTileKey& key, const std::function<bool()>& cancelSupplier) const;
+
+	//! Stops a pending prefetch of the tile, because the tile is being decoded for a request
+	void claimPendingPrefetch(const skybolt::QuadTreeTileKey& key) const;
+
+	//! @returns the tile's coverage from the coverage index if the tile is all land or all water, otherwise nullopt
+	std::optional<LandMaskCoverageIndex::TileCoverage> getUniformTileCoverage(const skybolt::QuadTreeTileKey& key) const;
 
 private:
 	bool mInterpretTextureAsDxt1Rgba;
+	bool mCompactUniformLandMask = false;
+	bool mGenerateMipmaps = false;
+
+	//! Compact masks of recently queried land mask tiles, for CPU-side land/water queries
+	mutable TileCache<LandMaskTilePtr> mLandMaskCache;
+	std::shared_ptr<LandMaskCoverageIndex> mCoverageIndex; //!< Null if not enabled
+
+	//! Images decoded for a co-scheduled source, not yet fetched
+	mutable TileCache<osg::ref_ptr<osg::Image>> mPrefetchedImageCache;
+
+	std::weak_ptr<const OrbiterImageTileSource> mCoScheduledSource;
+	std::weak_ptr<TileWorkerPool> mCoScheduleWorkerPool;
+	mutable std::mutex mCoScheduledSourceMutex;
+
+	mutable std::unordered_set<std::uint64_t> mPendingPrefetches; //!< Tile cache keys of prefetches queued on the worker pool
+	mutable std::mutex mPendingPrefetchesMutex;
 };
\ No newline at end of file
@@ -10,15 +10,28 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 */
 
 #include "OrbiterTileSource.h"
+#include "TileLoadShedder.h"
+#include "TileWorkerPool.h"
+#include "TreeArchiveValidator.h"
+#include "UnbufferedFile.h"
 #include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
 
 #include <osgDB/Registry>
+#include <boost/log/trivial.hpp>
 #include <boost/scope_exit.hpp>
 
 using namespace skybolt;
 
+// Inflated tiles of a layer are mostly the same size, so buffers are sized exactly rather than in powers of two.
+// This matters where decoders keep the buffer as image data.
+static constexpr std::size_t inflateBufferAlignment = 16;
+static constexpr std::size_t maxPooledInflateBufferBytes = 16 * 1024 * 1024;
+
 OrbiterTileSource::OrbiterTileSource(std::unique_ptr<ZTreeMgr> treeMgr) :
-	mTreeMgr(std::move(treeMgr))
+	mTreeMgr(std::move(treeMgr)),
+	mBadNodes(std::make_shared<BadTreeNodes>()),
+	mStats(std::make_shared<TileSourceStats>(mTreeMgr->ArchiveName())),
+	mInflateBufferPool(std::make_shared<AlignedBufferPool>(inflateBufferAlignment, maxPooledInflateBufferBytes, AlignedBufferPool::CapacityRounding::Alignment))
 {
 	if (mTreeMgr->TOC().size() == 0) // If load failed
 	{
@@ -28,36 +41,229 @@ OrbiterTileSource::OrbiterTileSource(std::unique_ptr<ZTreeMgr> treeMgr) :
 
 OrbiterTileSource::~OrbiterTileSource() = default;
 
-constexpr int orbiterLevelZeroOffset = 4; // Orbiter tile level numbering is skybolt level numbering +4.
+void OrbiterTileSource::enableUnbufferedIo(const std::shared_ptr<AlignedBufferPool>& bufferPool)
+{
+	if (!mTreeMgr)
+	{
+		return;
+	}
+
+	mUnbufferedFile = UnbufferedFile::open(mTreeMgr->ArchiveName());
+	if (mUnbufferedFile)
+	{
+		mBufferPool = bufferPool;
+	}
+	else
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Could not open '" << mTreeMgr->ArchiveName() << "' for unbuffered reading. Using buffered reading instead.";
+	}
+}
+
+void OrbiterTileSource::validateArchive(TileWorkerPool& workerPool)
+{
+	if (mTreeMgr)
+	{
+		validateTreeArchive(workerPool, mTreeMgr, mBadNodes, &logTreeArchiveReport);
+	}
+}
 
 osg::ref_ptr<osg::Image> OrbiterTileSource::createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const
+{
+	return readImage(key, std::move(cancelSupplier), ReadOrigin::Loader);
+}
+
+osg::ref_ptr<osg::Image> OrbiterTileSource::readImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier, ReadOrigin origin) const
+{
+	osg::ref_ptr<osg::Image> image;
+	readNode(key, std::move(cancelSupplier), origin, [&] (AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) {
+		image = createImage(key, buffer, sizeBytes);
+	});
+	return image;
+}
+
+bool OrbiterTileSource::readNode(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier, ReadOrigin origin, const NodeDecoder& decode) const
 {
 	if (!mTreeMgr)
 	{
-		return nullptr;
+		return false;
 	}
 
-	BYTE *buf;
+	// The index is immutable after the archive is opened, so can be accessed without locking
+	DWORD idx = mTreeMgr->Idx(key.level + orbiterLevelZeroOffset, key.y, key.x);
+	if (idx == (DWORD)-1 || mBadNodes->contains(idx))
+	{
+		return false;
+	}
 
-	// ReadData is not thread-safe, requiring threads to have exclusive access
-	std::scoped_lock<std::mutex> lock(mTreeMgrMutex);
-	DWORD ndata = mTreeMgr->ReadData(key.level + orbiterLevelZeroOffset, key.y, key.x, &buf);
+	TileSourceStats::add(mStats->requestCount, 1);
 
-	if (ndata == 0)
+	// Report queue depth and latency, including time spent waiting for the archive lock.
+	// Only the loader's requests are reported to the shedder, since the cap only relieves the loader.
+	const auto startTime = std::chrono::steady_clock::now();
+	TileSourceStats::add(mStats->inFlightRequestCount, 1);
+	TileLoadShedder* loadShedder = (origin == ReadOrigin::Loader) ? mLoadShedder.get() : nullptr;
+	if (loadShedder)
 	{
-		return nullptr;
+		loadShedder->requestStarted(key.level);
 	}
 
-	BOOST_SCOPE_EXIT(&mTreeMgr, &buf)
+	BOOST_SCOPE_EXIT(this_, startTime, loadShedder)
 	{
-		mTreeMgr->ReleaseData(buf);
+		auto latency = std::chrono::steady_clock::now() - startTime;
+		TileSourceStats::subtract(this_->mStats->inFlightRequestCount, 1);
+		TileSourceStats::add(this_->mStats->requestLatencyNs, std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+		if (loadShedder)
+		{
+			loadShedder->requestFinished(latency);
+		}
 	} BOOST_SCOPE_EXIT_END
 
-	return createImage(buf, ndata);
+	auto isCancelled = [&] {
+		if (cancelSupplier && cancelSupplier())
+		{
+			TileSourceStats::add(mStats->cancelledCount, 1);
+			return true;
+		}
+		return false;
+	};
+
+	if (isCancelled())
+	{
+		return false;
+	}
+
+	DeflatedData deflated;
+	bool read;
+	if (mUnbufferedFile)
+	{
+		// Unbuffered reads are positional and only use the immutable index, so requests read concurrently without the archive lock
+		read = readDataUnbuffered(idx, deflated);
+	}
+	else
+	{
+		// ReadDeflatedData is not thread-safe, requiring threads to have exclusive access
+		std::unique_lock<std::mutex> lock(mTreeMgrMutex, std::defer_lock);
+		{
+			ScopedStatTimer timer(mStats->lockWaitNs);
+			lock.lock();
+		}
+
+		// The request may have been cancelled while waiting for the lock
+		if (isCancelled())
+		{
+			return false;
+		}
+
+		read = readData(idx, deflated);
+	}
+
+	if (!read)
+	{
+		// Failing to allocate a read buffer says nothing about the node, so fail just this request
+		if (mUnbufferedFile && !deflated.buffer.data())
+		{
+			BOOST_LOG_TRIVIAL(warning) << "Could not allocate buffer to read tile " << key.level << "/" << key.x << "/" << key.y;
+			return false;
+		}
+
+		if (mTreeMgr->NodeSizeInflated(idx) != 0)
+		{
+			// Node has data which could not be read. Don't try to read it again.
+			mBadNodes->insert(idx);
+		}
+		return false;
+	}
+
+	// Inflating and decoding don't use the archive, so are done after releasing the lock to let other threads read
+	AlignedBufferPool::Buffer buffer;
+	std::uint32_t ndata = inflateData(idx, deflated, buffer);
+	if (!buffer.data())
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Could not allocate buffer to inflate tile " << key.level << "/" << key.x << "/" << key.y;
+		return false;
+	}
+	if (ndata == 0)
+	{
+		// Node has data which could not be inflated. Don't try to read it again.
+		mBadNodes->insert(idx);
+		return false;
+	}
+
+	TileSourceStats::add(mStats->bytesInflated, ndata);
+
+	ScopedStatTimer timer(mStats->decodeNs);
+	decode(buffer, ndata);
+	return true;
+}
+
+std::uint32_t OrbiterTileSource::inflateData(std::uint32_t idx, const DeflatedData& deflated, AlignedBufferPool::Buffer& out) const
+{
+	ScopedStatTimer timer(mStats->inflateNs);
+	out = mInflateBufferPool->acquire(getInflateBufferCapacity(mTreeMgr->NodeSizeInflated(idx)));
+	if (!out.data())
+	{
+		return 0;
+	}
+	return mTreeMgr->InflateData(idx, deflated.data, deflated.sizeBytes, out.data());
+}
+
+bool OrbiterTileSource::readData(std::uint32_t idx, DeflatedData& out) const
+{
+	BYTE *zbuf;
+	DWORD zsize;
+	{
+		ScopedStatTimer timer(mStats->readNs);
+		zsize = mTreeMgr->ReadDeflatedData(idx, &zbuf);
+	}
+
+	if (zsize == 0)
+	{
+		return false;
+	}
+	TileSourceStats::add(mStats->bytesRead, zsize);
+
+	out.treeMgrBuffer = std::shared_ptr<std::uint8_t>(zbuf, [treeMgr = mTreeMgr] (std::uint8_t* data) { treeMgr->ReleaseData(data); });
+	out.data = zbuf;
+	out.sizeBytes = zsize;
+	return true;
+}
+
+bool OrbiterTileSource::readDataUnbuffered(std::uint32_t idx, DeflatedData& out) const
+{
+	if (mTreeMgr->NodeSizeInflated(idx) == 0) // Node doesn't have data, but has descendants with data
+	{
+		return false;
+	}
+
+	DWORD zsize = mTreeMgr->NodeSizeDeflated(idx);
+	{
+		ScopedStatTimer timer(mStats->readNs);
+		if (!mUnbufferedFile->read(mTreeMgr->DataOffset() + mTreeMgr->TOC()[idx].pos, zsize, *mBufferPool, out.buffer, out.data))
+		{
+			return false;
+		}
+	}
+	TileSourceStats::add(mStats->bytesRead, zsize);
+
+	out.sizeBytes = zsize;
+	return true;
+}
+
+std::uint32_t OrbiterTileSource::getNodeIndex(const skybolt::QuadTreeTileKey& key) const
+{
+	return mTreeMgr ? mTreeMgr->Idx(key.level + orbiterLevelZeroOffset, key.y, key.x) : std::uint32_t(-1);
 }
 
 bool OrbiterTileSource::hasAnyChildren(const skybolt::QuadTreeTileKey& key) const
 {
+	if (mLoadShedder)
+	{
+		if (std::optional<int> levelCap = mLoadShedder->getLevelCap(); levelCap && key.level >= *levelCap)
+		{
+			return false;
+		}
+	}
+
 	if (mTreeMgr)
 	{
 		DWORD idx = mTreeMgr->Idx(key.level + orbiterLevelZeroOffset, key.y, key.x);
@@ -76,8 +282,8 @@ bool OrbiterTileSource::hasAnyChildren(const skybolt::QuadTreeTileKey& key) cons
 }
 
 //! @return index of tile with the given key if it exists. Returns -1 if it does not exist.
-//! @param highestTileOut is the key for the highest available tile found in the given tile's ancestry.
-static DWORD getHighestAvailableTile(const ZTreeMgr& treeMgr, int lvl, int ilat, int ilng, skybolt::QuadTreeTileKey& highestTileOut)
+//! @param highestTileOut is the key for the highest available tile found in the given tile's ancestry. Bad tiles are not considered available.
+static DWORD getHighestAvailableTile(const ZTreeMgr& treeMgr, const BadTreeNodes& badNodes, int lvl, int ilat, int ilng, skybolt::QuadTreeTileKey& highestTileOut)
 {
 	int idx;
 	if (lvl <= orbiterLevelZeroOffset)
@@ -90,7 +296,7 @@ static DWORD getHighestAvailableTile(const ZTreeMgr& treeMgr, int lvl, int ilat,
 		int plvl = lvl-1;
 		int pilat = ilat/2;
 		int pilng = ilng/2;
-		DWORD pidx = getHighestAvailableTile(treeMgr, plvl, pilat, pilng, highestTileOut);
+		DWORD pidx = getHighestAvailableTile(treeMgr, badNodes, plvl, pilat, pilng, highestTileOut);
 		if (pidx == (DWORD)-1)
 		{
 			// The parent does not exist, therefore this tile does not exist
@@ -103,7 +309,7 @@ static DWORD getHighestAvailableTile(const ZTreeMgr& treeMgr, int lvl, int ilat,
 		}
 	}
 
-	if (idx != -1)
+	if (idx != -1 && !badNodes.contains(idx))
 	{
 		highestTileOut.level = lvl;
 		highestTileOut.x = ilng;
@@ -114,12 +320,33 @@ static DWORD getHighestAvailableTile(const ZTreeMgr& treeMgr, int lvl, int ilat,
 }
 
 std::optional<skybolt::QuadTreeTileKey> OrbiterTileSource::getHighestAvailableLevel(const skybolt::QuadTreeTileKey& key) const
+{
+	std::optional<skybolt::QuadTreeTileKey> result = getHighestStoredLevel(key);
+	if (!result || !mLoadShedder)
+	{
+		return result;
+	}
+
+	// While loading is backlogged, serve the ancestor at the capped level in place of finer tiles.
+	// Ancestors of a stored tile are always in the archive.
+	if (std::optional<int> levelCap = mLoadShedder->getLevelCap(); levelCap && result->level > *levelCap)
+	{
+		int levelDelta = result->level - *levelCap;
+		result->level = *levelCap;
+		result->x >>= levelDelta;
+		result->y >>= levelDelta;
+		TileSourceStats::add(mStats->cappedRequestCount, 1);
+	}
+	return result;
+}
+
+std::optional<skybolt::QuadTreeTileKey> OrbiterTileSource::getHighestStoredLevel(const skybolt::QuadTreeTileKey& key) const
 {
 	if (mTreeMgr)
 	{
 		skybolt::QuadTreeTileKey result;
 		result.level = -1;
-		getHighestAvailableTile(*mTreeMgr, key.level + orbiterLevelZeroOffset, key.y, key.x, result);
+		getHighestAvailableTile(*mTreeMgr, *mBadNodes, key.level + orbiterLevelZeroOffset, key.y, key.x, result);
 	
 		if (result.level != -1)
 		{
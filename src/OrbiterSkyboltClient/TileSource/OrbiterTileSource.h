@@ -11,32 +11,122 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #pragma once
 
+#include "AlignedBufferPool.h"
+#include "TileSourceStats.h"
+
 #include <SkyboltVis/Renderable/Planet/Tile/TileSource/TileSource.h>
 
+class BadTreeNodes;
+class TileLoadShedder;
+class TileWorkerPool;
+class UnbufferedFile;
 class ZTreeMgr;
 
+constexpr int orbiterLevelZeroOffset = 4; // Orbiter tile level numbering is skybolt level numbering +4.
+
 class OrbiterTileSource : public skybolt::vis::TileSource
 {
 public:
 	OrbiterTileSource(std::unique_ptr<ZTreeMgr> treeMgr);
 	~OrbiterTileSource() override;
 
+	//! Reads the tile for Skybolt's tile loader, reporting the request to the load shedder
 	//!@ThreadSafe
 	osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier) const;
 
+	//! @returns false for tiles at or above the load shedder's level cap, so that Skybolt stops subdividing while the cap holds
+	//! and subdivides again, requesting finer tiles, once it is raised
 	//!@ThreadSafe
 	bool hasAnyChildren(const skybolt::QuadTreeTileKey& key) const override;
 
-	//! @returns the highest key with source data in the given key's ancestral hierarchy
+	//! @returns the highest key with source data in the given key's ancestral hierarchy, no higher than the load shedder's level cap if any
 	//!@ThreadSafe
 	std::optional<skybolt::QuadTreeTileKey> getHighestAvailableLevel(const skybolt::QuadTreeTileKey& key) const  override;
 
+	//! As getHighestAvailableLevel(), but ignores the load shedder's level cap.
+	//! For CPU-side consumers such as height queries, which need full detail regardless of the rendering backlog.
+	//!@ThreadSafe
+	std::optional<skybolt::QuadTreeTileKey> getHighestStoredLevel(const skybolt::QuadTreeTileKey& key) const;
+
 	const std::string& getCacheSha() const override  { static std::string s = "OrbiterTileSource"; return s; }
 
+	//! Reads the archive with OS caching disabled, so that tile caches are the only caches of archive data.
+	//! Falls back to buffered reading if the archive cannot be opened for unbuffered reading.
+	//! Must be called before the source is used.
+	void enableUnbufferedIo(const std::shared_ptr<AlignedBufferPool>& bufferPool);
+
+	//! Reports requests to the load shedder, and caps the level of tiles reported as available while the shedder is capping.
+	//! Must be called before the source is used.
+	void setLoadShedder(const std::shared_ptr<TileLoadShedder>& loadShedder) { mLoadShedder = loadShedder; }
+
+	//! Validates the archive in the background. Nodes found to be bad are skipped from then on.
+	void validateArchive(TileWorkerPool& workerPool);
+
+	//! @returns counters for this source's loading pipeline, which may be read at any time
+	const TileSourceStatsPtr& getStats() const { return mStats; }
+
 protected:
-	virtual osg::ref_ptr<osg::Image> createImage(const std::uint8_t* buffer, std::size_t sizeBytes)const = 0;
+	//! @returns the tree archive, or null if it could not be loaded
+	const std::shared_ptr<ZTreeMgr>& getTreeMgr() const { return mTreeMgr; }
+
+	//! @returns the archive node index of the tile, or -1 if the tile is not in the archive
+	std::uint32_t getNodeIndex(const skybolt::QuadTreeTileKey& key) const;
+
+	enum class ReadOrigin
+	{
+		Loader, //!< Request from Skybolt's tile loader, which is reported to the load shedder
+		Background //!< CPU-side queries, prefetching and other background reads, which must not cap the loader's tiles
+	};
+
+	//! Reads and decodes the tile
+	//!@ThreadSafe
+	osg::ref_ptr<osg::Image> readImage(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier, ReadOrigin origin) const;
+
+	//! Called with the inflated node data, with the same contract as createImage(key, buffer, sizeBytes)
+	using NodeDecoder = std::function<void(AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes)>;
+
+	//! Reads and inflates the tile's node data, and passes it to decode on the calling thread.
+	//! Lets derived classes decode to types other than images.
+	//! @returns false if the node could not be read, in which case decode is not called
+	//!@ThreadSafe
+	bool readNode(const skybolt::QuadTreeTileKey& key, std::function<bool()> cancelSupplier, ReadOrigin origin, const NodeDecoder& decode) const;
+
+	//! Called without access to the tree archive, possibly concurrently from multiple threads.
+	//! @param buffer holds the inflated node data. Implementations may move from it to take ownership of the data without copying.
+	virtual osg::ref_ptr<osg::Image> createImage(const skybolt::QuadTreeTileKey& key, AlignedBufferPool::Buffer& buffer, std::size_t sizeBytes) const = 0;
+
+	//! @returns capacity of the buffer to inflate node data of the given size into.
+	//! Implementations may reserve room after the data for decoding in place.
+	virtual std::size_t getInflateBufferCapacity(std::size_t sizeBytes) const { return sizeBytes; }
+
+private:
+	//! Node data as read from the archive, before inflating
+	struct DeflatedData
+	{
+		const std::uint8_t* data = nullptr;
+		std::uint32_t sizeBytes = 0;
+		AlignedBufferPool::Buffer buffer; //!< Holds the data if read unbuffered
+		std::shared_ptr<std::uint8_t> treeMgrBuffer; //!< Holds the data if read through the tree manager
+	};
+
+	//! Read node data. Caller must have exclusive access to the archive.
+	//! @returns false if the data could not be read
+	bool readData(std::uint32_t idx, DeflatedData& out) const;
+
+	//! As readData(), but reads through the unbuffered file, so does not require exclusive access to the archive
+	bool readDataUnbuffered(std::uint32_t idx, DeflatedData& out) const;
+
+	//! Inflates node data into a buffer from the inflate buffer pool. Does not require access to the archive.
+	//! @returns inflated size, or 0 if the data could not be inflated
+	std::uint32_t inflateData(std::uint32_t idx, const DeflatedData& deflated, AlignedBufferPool::Buffer& out) const;
 
 private:
-	std::unique_ptr<ZTreeMgr> mTreeMgr;
+	std::shared_ptr<ZTreeMgr> mTreeMgr;
 	mutable std::mutex mTreeMgrMutex;
+	std::shared_ptr<BadTreeNodes> mBadNodes; //!< Nodes which failed validation or could not be read
+	TileSourceStatsPtr mStats;
+	std::unique_ptr<UnbufferedFile> mUnbufferedFile; //!< Null if reading through the OS page cache
+	std::shared_ptr<AlignedBufferPool> mBufferPool;
+	std::shared_ptr<AlignedBufferPool> mInflateBufferPool; //!< Buffers may outlive the tile source if decoders take ownership
+	std::shared_ptr<TileLoadShedder> mLoadShedder; //!< May be null
 };
\ No newline at end of file
@@ -0,0 +1,205 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "SurfaceLabelIndex.h"
+#include "OrbiterTileSource.h"
+#include "TileCache.h"
+#include "TileWorkerPool.h"
+#include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
+
+#include <boost/scope_exit.hpp>
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+using namespace skybolt;
+
+struct SurfaceLabelIndex::State
+{
+	std::unique_ptr<ZTreeMgr> treeMgr;
+	std::mutex treeMgrMutex;
+
+	std::mutex tilesMutex;
+	//! Null values are tiles queued for parsing
+	std::unordered_map<std::uint64_t, SurfaceLabelTilePtr> tiles;
+};
+
+SurfaceLabelIndex::SurfaceLabelIndex(const std::string& directory, const std::shared_ptr<TileWorkerPool>& workerPool) :
+	mState(std::make_shared<State>()),
+	mWorkerPool(workerPool)
+{
+	assert(mWorkerPool);
+	mState->treeMgr = std::make_unique<ZTreeMgr>(directory.c_str(), ZTreeMgr::LAYER_LABEL);
+	if (mState->treeMgr->TOC().size() == 0) // If load failed
+	{
+		mState->treeMgr.reset();
+	}
+}
+
+SurfaceLabelIndex::~SurfaceLabelIndex() = default;
+
+bool SurfaceLabelIndex::isValid() const
+{
+	return mState->treeMgr != nullptr;
+}
+
+static std::string trim(const std::string& str)
+{
+	size_t begin = str.find_first_not_of(" \t\r\"");
+	if (begin == std::string::npos)
+	{
+		return "";
+	}
+	size_t end = str.find_last_not_of(" \t\r\"");
+	return str.substr(begin, end - begin + 1);
+}
+
+//! Parses label lines of the form: <type> <latitude> <longitude> [altitude] <name>
+//! where angles are in degrees and the name may be quoted.
+static std::vector<SurfaceLabel> parseLabels(const char* data, std::size_t sizeBytes)
+{
+	std::vector<SurfaceLabel> labels;
+
+	std::istringstream ss(std::string(data, sizeBytes));
+	std::string line;
+	while (std::getline(ss, line))
+	{
+		std::istringstream ls(line);
+		SurfaceLabel label;
+		if (!(ls >> label.type >> label.latitude >> label.longitude))
+		{
+			continue;
+		}
+
+		std::string remainder;
+		std::getline(ls, remainder);
+
+		// Altitude is optional
+		const char* begin = remainder.c_str();
+		char* end;
+		label.altitude = std::strtod(begin, &end);
+		if (end == begin || (*end != ' ' && *end != '\t'))
+		{
+			label.altitude = 0;
+			end = const_cast<char*>(begin);
+		}
+
+		label.name = trim(end);
+		if (label.name.empty())
+		{
+			continue;
+		}
+
+		constexpr double degToRad = 3.14159265358979323846 / 180.0;
+		label.latitude *= degToRad;
+		label.longitude *= degToRad;
+		labels.push_back(std::move(label));
+	}
+	return labels;
+}
+
+static SurfaceLabelTilePtr readTile(ZTreeMgr& treeMgr, std::mutex& treeMgrMutex, DWORD idx)
+{
+	auto tile = std::make_shared<SurfaceLabelTile>();
+
+	BYTE* buf = nullptr;
+	DWORD ndata;
+	{
+		std::scoped_lock<std::mutex> lock(treeMgrMutex);
+		ndata = treeMgr.ReadData(idx, &buf);
+	}
+
+	if (ndata > 0)
+	{
+		BOOST_SCOPE_EXIT(&treeMgr, &buf)
+		{
+			treeMgr.ReleaseData(buf);
+		} BOOST_SCOPE_EXIT_END
+
+		tile->labels = parseLabels(reinterpret_cast<const char*>(buf), ndata);
+	}
+	return tile;
+}
+
+void SurfaceLabelIndex::query(const std::vector<QuadTreeTileKey>& keys, std::vector<SurfaceLabelTilePtr>& tilesOut) const
+{
+	if (!mState->treeMgr)
+	{
+		return;
+	}
+
+	std::scoped_lock<std::mutex> lock(mState->tilesMutex);
+	for (const QuadTreeTileKey& key : keys)
+	{
+		std::uint64_t cacheKey = toTileCacheKey(key);
+		if (auto i = mState->tiles.find(cacheKey); i != mState->tiles.end())
+		{
+			if (i->second && !i->second->labels.empty())
+			{
+				tilesOut.push_back(i->second);
+			}
+			continue;
+		}
+
+		// The index is immutable after the archive is opened, so can be accessed without locking
+		DWORD idx = mState->treeMgr->Idx(key.level + orbiterLevelZeroOffset, key.y, key.x);
+		if (idx == (DWORD)-1 || mState->treeMgr->NodeSizeInflated(idx) == 0)
+		{
+			static const SurfaceLabelTilePtr emptyTile = std::make_shared<SurfaceLabelTile>();
+			mState->tiles[cacheKey] = emptyTile;
+			continue;
+		}
+
+		mState->tiles[cacheKey] = nullptr;
+		mWorkerPool->submit([state = mState, cacheKey, idx] {
+			SurfaceLabelTilePtr tile = readTile(*state->treeMgr, state->treeMgrMutex, idx);
+			std::scoped_lock<std::mutex> lock(state->tilesMutex);
+			state->tiles[cacheKey] = tile;
+		});
+	}
+}
+
+void SurfaceLabelIndex::getTileKeysInBounds(int level, double minLatitude, double maxLatitude, double minLongitude, double maxLongitude, std::vector<QuadTreeTileKey>& keysOut)
+{
+	constexpr double pi = 3.14159265358979323846;
+	const int latTileCount = 1 << level;
+	const int lonTileCount = 2 << level;
+	const double tileSize = pi / latTileCount;
+
+	// Orbiter tile rows are numbered from north to south
+	int yMin = std::clamp(int(std::floor((pi / 2 - maxLatitude) / tileSize)), 0, latTileCount - 1);
+	int yMax = std::clamp(int(std::floor((pi / 2 - minLatitude) / tileSize)), 0, latTileCount - 1);
+
+	int xMin = int(std::floor((minLongitude + pi) / tileSize));
+	int xMax = int(std::floor((maxLongitude + pi) / tileSize));
+	if (xMax - xMin + 1 >= lonTileCount)
+	{
+		xMin = 0;
+		xMax = lonTileCount - 1;
+	}
+
+	QuadTreeTileKey key;
+	key.level = level;
+	for (int y = yMin; y <= yMax; ++y)
+	{
+		key.y = y;
+		for (int x = xMin; x <= xMax; ++x)
+		{
+			key.x = ((x % lonTileCount) + lonTileCount) % lonTileCount;
+			keysOut.push_back(key);
+		}
+	}
+}
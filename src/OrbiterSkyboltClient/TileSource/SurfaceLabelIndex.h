@@ -0,0 +1,64 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <SkyboltCommon/Math/QuadTree.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TileWorkerPool;
+
+struct SurfaceLabel
+{
+	double latitude; //!< radians
+	double longitude; //!< radians
+	double altitude; //!< meters above mean planet radius
+	std::string type; //!< Label type identifier from the archive
+	std::string name;
+};
+
+struct SurfaceLabelTile
+{
+	std::vector<SurfaceLabel> labels;
+};
+
+using SurfaceLabelTilePtr = std::shared_ptr<const SurfaceLabelTile>;
+
+//! Index of the place name labels in a planet's Label archive.
+//! Each tile is parsed once on the worker pool the first time it is queried, then kept resident.
+class SurfaceLabelIndex
+{
+public:
+	SurfaceLabelIndex(const std::string& directory, const std::shared_ptr<TileWorkerPool>& workerPool);
+	~SurfaceLabelIndex();
+
+	//! @returns false if the planet has no label archive
+	bool isValid() const;
+
+	//! Appends the label tiles for the given keys to tilesOut.
+	//! Tiles which have not been parsed yet are queued for parsing, and are returned by later queries once ready.
+	//! Keys with no labels in the archive are skipped after an index lookup.
+	//!@ThreadSafe
+	void query(const std::vector<skybolt::QuadTreeTileKey>& keys, std::vector<SurfaceLabelTilePtr>& tilesOut) const;
+
+	//! Appends keys of tiles at the given level which overlap the given latitude and longitude bounds.
+	//! Longitude bounds may extend beyond [-pi, pi] and are wrapped.
+	static void getTileKeysInBounds(int level, double minLatitude, double maxLatitude, double minLongitude, double maxLongitude, std::vector<skybolt::QuadTreeTileKey>& keysOut);
+
+private:
+	// Shared with queued parse tasks so that they can safely outlive the index
+	struct State;
+	std::shared_ptr<State> mState;
+	std::shared_ptr<TileWorkerPool> mWorkerPool;
+};
@@ -0,0 +1,206 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TerrainHeightQuery.h"
+#include "TileWorkerPool.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace skybolt;
+
+constexpr double pi = 3.14159265358979323846;
+
+TerrainHeightQuery::TerrainHeightQuery(std::shared_ptr<const OrbiterElevationTileSource> source, std::shared_ptr<TileWorkerPool> workerPool, int maxLevel) :
+	mSource(std::move(source)),
+	mWorkerPool(std::move(workerPool)),
+	mMaxLevel(maxLevel),
+	mPendingFetches(std::make_shared<PendingFetches>())
+{
+	assert(mSource);
+}
+
+TerrainHeightQuery::~TerrainHeightQuery() = default;
+
+QuadTreeTileKey TerrainHeightQuery::getTileKey(int level, const LatLon& point)
+{
+	// Orbiter tile rows are numbered from north to south
+	const int latTileCount = 1 << level;
+	const int lonTileCount = 2 << level;
+	const double tileSize = pi / latTileCount;
+
+	QuadTreeTileKey key;
+	key.level = level;
+	key.y = std::clamp(int((pi / 2 - point.latitude) / tileSize), 0, latTileCount - 1);
+	int x = int(std::floor((point.longitude + pi) / tileSize));
+	key.x = ((x % lonTileCount) + lonTileCount) % lonTileCount;
+	return key;
+}
+
+double TerrainHeightQuery::sampleHeight(const DecodedElevationTile& tile, const std::uint16_t* texels, const QuadTreeTileKey& key, const LatLon& point)
+{
+	const double tileSize = pi / (1 << key.level);
+	const double tileSouth = pi / 2 - (key.y + 1) * tileSize;
+	const double tileWest = key.x * tileSize - pi;
+
+	// Wrap longitude into the tile's range
+	double longitude = std::remainder(point.longitude - tileWest, 2 * pi);
+	if (longitude < 0)
+	{
+		longitude += 2 * pi;
+	}
+
+	// Texel rows start at the southern edge of the tile
+	const int width = tile.texels.getWidth();
+	const int height = tile.texels.getHeight();
+	double u = std::clamp(longitude / tileSize, 0.0, 1.0) * (width - 1);
+	double v = std::clamp((point.latitude - tileSouth) / tileSize, 0.0, 1.0) * (height - 1);
+
+	int x0 = std::min(int(u), width - 2);
+	int y0 = std::min(int(v), height - 2);
+	double fx = u - x0;
+	double fy = v - y0;
+
+	const std::uint16_t* row0 = texels + y0 * width + x0;
+	const std::uint16_t* row1 = row0 + width;
+	double bottom = row0[0] + (row0[1] - row0[0]) * fx;
+	double top = row1[0] + (row1[1] - row1[0]) * fx;
+
+	// Bilinear interpolation commutes with the linear mapping from texels to elevation
+	return (bottom + (top - bottom) * fy - 32768) * tile.scale + tile.offset;
+}
+
+DecodedElevationTilePtr TerrainHeightQuery::findTile(QuadTreeTileKey& keyInOut, MissingTilePolicy policy) const
+{
+	std::optional<QuadTreeTileKey> availableKey = mSource->getHighestStoredLevel(keyInOut);
+	if (!availableKey)
+	{
+		return nullptr;
+	}
+	keyInOut = *availableKey;
+
+	if (policy == MissingTilePolicy::Block)
+	{
+		if (DecodedElevationTilePtr tile = mSource->getTile(keyInOut); tile)
+		{
+			return tile;
+		}
+	}
+
+	// Fall back to the best cached ancestor
+	QuadTreeTileKey key = keyInOut;
+	for (;;)
+	{
+		if (DecodedElevationTilePtr tile = mSource->getCachedTile(key); tile)
+		{
+			if (policy == MissingTilePolicy::FetchAsync && key.level != keyInOut.level)
+			{
+				fetchAsync(keyInOut);
+			}
+			keyInOut = key;
+			return tile;
+		}
+
+		if (key.level == 0)
+		{
+			break;
+		}
+		key.level -= 1;
+		key.x /= 2;
+		key.y /= 2;
+	}
+
+	if (policy == MissingTilePolicy::FetchAsync)
+	{
+		fetchAsync(keyInOut);
+	}
+	return nullptr;
+}
+
+void TerrainHeightQuery::fetchAsync(const QuadTreeTileKey& key) const
+{
+	if (!mWorkerPool)
+	{
+		return;
+	}
+
+	std::uint64_t cacheKey = toTileCacheKey(key);
+	{
+		std::scoped_lock<std::mutex> lock(mPendingFetches->mutex);
+		if (!mPendingFetches->keys.insert(cacheKey).second)
+		{
+			return; // Already pending
+		}
+	}
+
+	mWorkerPool->submit([source = mSource, pending = mPendingFetches, key, cacheKey] {
+		source->getTile(key);
+		std::scoped_lock<std::mutex> lock(pending->mutex);
+		pending->keys.erase(cacheKey);
+	});
+}
+
+void TerrainHeightQuery::query(const std::vector<LatLon>& points, MissingTilePolicy policy, std::vector<double>& heightsOut) const
+{
+	heightsOut.assign(points.size(), std::numeric_limits<double>::quiet_NaN());
+
+	// Sort points by tile at the max level so that each tile is looked up and expanded once
+	std::vector<std::uint64_t> pointTileKeys(points.size());
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		pointTileKeys[i] = toTileCacheKey(getTileKey(mMaxLevel, points[i]));
+	}
+
+	std::vector<size_t> order(points.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return pointTileKeys[a] < pointTileKeys[b]; });
+
+	std::vector<std::uint16_t> texels;
+	DecodedElevationTilePtr expandedTile;
+
+	for (size_t begin = 0; begin < order.size();)
+	{
+		size_t end = begin + 1;
+		while (end < order.size() && pointTileKeys[order[end]] == pointTileKeys[order[begin]])
+		{
+			++end;
+		}
+
+		QuadTreeTileKey key = getTileKey(mMaxLevel, points[order[begin]]);
+		DecodedElevationTilePtr tile = findTile(key, policy);
+		if (tile)
+		{
+			// Neighbouring max level tiles often resolve to the same ancestor, so avoid expanding it again
+			if (tile != expandedTile)
+			{
+				texels.resize(std::size_t(tile->texels.getWidth()) * tile->texels.getHeight());
+				tile->texels.decode(texels.data());
+				expandedTile = tile;
+			}
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				heightsOut[order[i]] = sampleHeight(*tile, texels.data(), key, points[order[i]]);
+			}
+		}
+		begin = end;
+	}
+}
+
+double TerrainHeightQuery::query(const LatLon& point, MissingTilePolicy policy) const
+{
+	std::vector<double> heights;
+	query({point}, policy, heights);
+	return heights.front();
+}
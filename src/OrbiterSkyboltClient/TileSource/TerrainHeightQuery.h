@@ -0,0 +1,80 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "OrbiterElevationTileSource.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class TileWorkerPool;
+
+//! Geodetic position in radians
+struct LatLon
+{
+	double latitude;
+	double longitude;
+};
+
+//! Queries terrain heights on the CPU from an elevation tile source, for uses such as shadows, collision and camera clamping.
+class TerrainHeightQuery
+{
+public:
+	//! @param maxLevel is the highest (skybolt numbered) tile level to sample
+	TerrainHeightQuery(std::shared_ptr<const OrbiterElevationTileSource> source, std::shared_ptr<TileWorkerPool> workerPool, int maxLevel);
+	~TerrainHeightQuery();
+
+	enum class MissingTilePolicy
+	{
+		UseCached, //!< Use the best cached ancestor of missing tiles
+		FetchAsync, //!< Use the best cached ancestor of missing tiles, and load missing tiles in the background for later queries
+		Block //!< Load missing tiles before returning
+	};
+
+	//! Samples heights above the reference radius with bilinear filtering, from the highest available level.
+	//! Points are grouped by tile so that each tile is expanded once per batch.
+	//! @param heightsOut is set to a height for each point, or NaN where no tile is available
+	//!@ThreadSafe
+	void query(const std::vector<LatLon>& points, MissingTilePolicy policy, std::vector<double>& heightsOut) const;
+
+	//! Convenience for querying a single point
+	//!@ThreadSafe
+	double query(const LatLon& point, MissingTilePolicy policy) const;
+
+	//! @returns the key of the tile containing the point at the given level
+	static skybolt::QuadTreeTileKey getTileKey(int level, const LatLon& point);
+
+	//! @returns height sampled from a tile with bilinear filtering. Texel rows run from the tile's southern edge to its northern edge.
+	//! @param texels are the expanded texels of the tile
+	static double sampleHeight(const DecodedElevationTile& tile, const std::uint16_t* texels, const skybolt::QuadTreeTileKey& key, const LatLon& point);
+
+private:
+	//! @returns the tile to sample for the tile key, according to the policy. Returns null if no tile is available.
+	//! @param keyInOut is the requested key, and is set to the key of the returned tile
+	DecodedElevationTilePtr findTile(skybolt::QuadTreeTileKey& keyInOut, MissingTilePolicy policy) const;
+
+	void fetchAsync(const skybolt::QuadTreeTileKey& key) const;
+
+private:
+	std::shared_ptr<const OrbiterElevationTileSource> mSource;
+	std::shared_ptr<TileWorkerPool> mWorkerPool;
+	const int mMaxLevel;
+
+	struct PendingFetches
+	{
+		std::mutex mutex;
+		std::unordered_set<std::uint64_t> keys;
+	};
+	std::shared_ptr<PendingFetches> mPendingFetches;
+};
@@ -0,0 +1,432 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TerrainRaycaster.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <map>
+
+using namespace skybolt;
+
+constexpr double pi = 3.14159265358979323846;
+
+static osg::Vec3d toUnitVector(double latitude, double longitude)
+{
+	double cosLat = std::cos(latitude);
+	return osg::Vec3d(cosLat * std::cos(longitude), std::sin(latitude), cosLat * std::sin(longitude));
+}
+
+static LatLon toLatLon(const osg::Vec3d& position)
+{
+	return {std::asin(std::clamp(position.y() / position.length(), -1.0, 1.0)), std::atan2(position.z(), position.x())};
+}
+
+//! Area of the planet between two radii, within a latitude and longitude range
+struct TerrainRaycaster::Region
+{
+	double south;
+	double north;
+	double west;
+	double east;
+	double minRadius;
+	double maxRadius;
+
+	//! @returns the range of ray distances within a sphere bounding the region, clipped to [tMin, tMax]
+	bool intersect(const TerrainRay& ray, double tMin, double tMax, double& tEnterOut, double& tExitOut) const
+	{
+		// The region lies within a cone about its central direction. Sample the boundary to find the cone's half angle.
+		osg::Vec3d axis = toUnitVector((south + north) / 2, (west + east) / 2);
+		double minCosAngle = 1;
+		for (double latitude : {south, (south + north) / 2, north})
+		{
+			for (double longitude : {west, (west + east) / 2, east})
+			{
+				minCosAngle = std::min(minCosAngle, axis * toUnitVector(latitude, longitude));
+			}
+		}
+		minCosAngle = std::max(0.0, minCosAngle);
+		double sinAngle = std::sqrt(1 - minCosAngle * minCosAngle);
+
+		// Bound the cone's intersection with the shell by a sphere centred on the axis.
+		// Distance from an axis point increases with angle from the axis, so the furthest points lie on the cone's edge at the min or max radius.
+		double centreDistance = (minRadius * minCosAngle + maxRadius) / 2;
+		auto distanceToEdge = [&](double radius) {
+			double dz = radius * minCosAngle - centreDistance;
+			double dr = radius * sinAngle;
+			return std::sqrt(dz * dz + dr * dr);
+		};
+		double boundingRadius = std::max({distanceToEdge(minRadius), distanceToEdge(maxRadius), maxRadius - centreDistance});
+
+		osg::Vec3d toCentre = axis * centreDistance - ray.origin;
+		double tClosest = toCentre * ray.direction;
+		double missDistance2 = toCentre.length2() - tClosest * tClosest;
+		double halfChord2 = boundingRadius * boundingRadius - missDistance2;
+		if (halfChord2 < 0)
+		{
+			return false;
+		}
+		double halfChord = std::sqrt(halfChord2);
+		tEnterOut = std::max(tMin, tClosest - halfChord);
+		tExitOut = std::min(tMax, tClosest + halfChord);
+		return tEnterOut <= tExitOut;
+	}
+};
+
+struct TerrainRaycaster::Context
+{
+	const TerrainRay* ray;
+	std::optional<TerrainRayHit> hit;
+
+	double getMaxDistance() const { return hit ? hit->distance : ray->maxDistance; }
+
+	//! Texels of tiles expanded during the batch
+	std::map<const DecodedElevationTile*, std::pair<DecodedElevationTilePtr, std::vector<std::uint16_t>>> expandedTiles;
+
+	const std::uint16_t* getTexels(const DecodedElevationTilePtr& tile)
+	{
+		auto& entry = expandedTiles[tile.get()];
+		if (!entry.first)
+		{
+			entry.first = tile;
+			entry.second.resize(std::size_t(tile->texels.getWidth()) * tile->texels.getHeight());
+			tile->texels.decode(entry.second.data());
+		}
+		return entry.second.data();
+	}
+};
+
+TerrainRaycaster::TerrainRaycaster(const TerrainRaycasterConfig& config) :
+	mConfig(config)
+{
+	assert(mConfig.source);
+}
+
+TerrainRaycaster::~TerrainRaycaster() = default;
+
+TerrainRaycaster::Region TerrainRaycaster::getTileRegion(const QuadTreeTileKey& key, double minElevation, double maxElevation) const
+{
+	const double tileSize = pi / (1 << key.level);
+	Region region;
+	region.north = pi / 2 - key.y * tileSize;
+	region.south = region.north - tileSize;
+	region.west = key.x * tileSize - pi;
+	region.east = region.west + tileSize;
+	region.minRadius = mConfig.planetRadius + minElevation;
+	region.maxRadius = mConfig.planetRadius + maxElevation;
+	return region;
+}
+
+std::optional<TerrainRayHit> TerrainRaycaster::raycast(const TerrainRay& ray) const
+{
+	std::vector<std::optional<TerrainRayHit>> hits;
+	raycast({ray}, hits);
+	return hits.front();
+}
+
+void TerrainRaycaster::raycast(const std::vector<TerrainRay>& rays, std::vector<std::optional<TerrainRayHit>>& hitsOut) const
+{
+	hitsOut.resize(rays.size());
+
+	Context context;
+	for (size_t i = 0; i < rays.size(); ++i)
+	{
+		context.ray = &rays[i];
+		context.hit.reset();
+
+		// Level zero has two tiles, each covering a hemisphere of longitude
+		for (int x = 0; x < 2; ++x)
+		{
+			QuadTreeTileKey key;
+			key.level = 0;
+			key.x = x;
+			key.y = 0;
+			if (DecodedElevationTilePtr tile = mConfig.source->getTile(key); tile)
+			{
+				raycastTile(context, key, tile);
+			}
+		}
+		hitsOut[i] = context.hit;
+	}
+}
+
+void TerrainRaycaster::raycastTile(Context& context, const QuadTreeTileKey& key, const DecodedElevationTilePtr& tile) const
+{
+	Region region = getTileRegion(key, tile->minElevation - mConfig.boundsMargin, tile->maxElevation + mConfig.boundsMargin);
+	double tEnter, tExit;
+	if (!region.intersect(*context.ray, 0, context.getMaxDistance(), tEnter, tExit))
+	{
+		return;
+	}
+
+	if (key.level >= mConfig.maxLevel)
+	{
+		raycastTexels(context, key, tile, 0, 0, tile->texels.getWidth() - 1, tile->texels.getHeight() - 1);
+		return;
+	}
+
+	// Visit child quadrants front to back. Quadrants without a child tile are intersected with this tile's texels instead.
+	struct Quadrant
+	{
+		QuadTreeTileKey key;
+		double tEnter;
+	};
+	std::vector<Quadrant> quadrants;
+	quadrants.reserve(4);
+
+	for (int dy = 0; dy < 2; ++dy)
+	{
+		for (int dx = 0; dx < 2; ++dx)
+		{
+			Quadrant quadrant;
+			quadrant.key.level = key.level + 1;
+			quadrant.key.x = key.x * 2 + dx;
+			quadrant.key.y = key.y * 2 + dy;
+
+			Region quadrantRegion = getTileRegion(quadrant.key, region.minRadius - mConfig.planetRadius, region.maxRadius - mConfig.planetRadius);
+			double quadrantExit;
+			if (quadrantRegion.intersect(*context.ray, tEnter, tExit, quadrant.tEnter, quadrantExit))
+			{
+				quadrants.push_back(quadrant);
+			}
+		}
+	}
+
+	std::sort(quadrants.begin(), quadrants.end(), [](const Quadrant& a, const Quadrant& b) { return a.tEnter < b.tEnter; });
+
+	for (const Quadrant& quadrant : quadrants)
+	{
+		if (quadrant.tEnter > context.getMaxDistance())
+		{
+			break;
+		}
+
+		// Child tiles are read only once the ray is known to reach them, since reading may block on I/O
+		DecodedElevationTilePtr quadrantTile;
+		std::optional<QuadTreeTileKey> availableKey = mConfig.source->getHighestStoredLevel(quadrant.key);
+		if (availableKey && availableKey->level == quadrant.key.level)
+		{
+			quadrantTile = mConfig.source->getTile(quadrant.key);
+		}
+
+		if (quadrantTile)
+		{
+			raycastTile(context, quadrant.key, quadrantTile);
+		}
+		else
+		{
+			// Rows run from south to north, whereas tile keys are numbered from north to south
+			const int halfCellsX = (tile->texels.getWidth() - 1) / 2;
+			const int halfCellsY = (tile->texels.getHeight() - 1) / 2;
+			int minCellX = (quadrant.key.x & 1) * halfCellsX;
+			int minCellY = (1 - (quadrant.key.y & 1)) * halfCellsY;
+			raycastTexels(context, key, tile, minCellX, minCellY, minCellX + halfCellsX - 1, minCellY + halfCellsY - 1);
+		}
+	}
+}
+
+void TerrainRaycaster::raycastTexels(Context& context, const QuadTreeTileKey& key, const DecodedElevationTilePtr& tile,
+	int minCellX, int minCellY, int maxCellX, int maxCellY) const
+{
+	const std::uint16_t* texels = context.getTexels(tile);
+	const ElevationMinMaxPyramid& pyramid = tile->texelBoundsPyramid;
+	raycastBlock(context, key, *tile, texels, pyramid.getLevelCount() - 1, 0, 0, minCellX, minCellY, maxCellX, maxCellY);
+}
+
+void TerrainRaycaster::raycastBlock(Context& context, const QuadTreeTileKey& key, const DecodedElevationTile& tile, const std::uint16_t* texels,
+	int level, int blockX, int blockY, int minCellX, int minCellY, int maxCellX, int maxCellY) const
+{
+	const ElevationMinMaxPyramid& pyramid = tile.texelBoundsPyramid;
+	const int blockSize = pyramid.getBlockSize(level);
+	const int cellCountX = tile.texels.getWidth() - 1;
+	const int cellCountY = tile.texels.getHeight() - 1;
+
+	// Clip block to the requested cell rectangle
+	int x0 = std::max(blockX * blockSize, minCellX);
+	int y0 = std::max(blockY * blockSize, minCellY);
+	int x1 = std::min(std::min((blockX + 1) * blockSize, cellCountX) - 1, maxCellX);
+	int y1 = std::min(std::min((blockY + 1) * blockSize, cellCountY) - 1, maxCellY);
+	if (x0 > x1 || y0 > y1)
+	{
+		return;
+	}
+
+	double minElevation, maxElevation;
+	tile.toElevationBounds(pyramid.getBounds(level, blockX, blockY), minElevation, maxElevation);
+
+	const double tileSize = pi / (1 << key.level);
+	const double cellSizeX = tileSize / cellCountX;
+	const double cellSizeY = tileSize / cellCountY;
+	Region tileRegion = getTileRegion(key, 0, 0);
+
+	Region region;
+	region.south = tileRegion.south + y0 * cellSizeY;
+	region.north = tileRegion.south + (y1 + 1) * cellSizeY;
+	region.west = tileRegion.west + x0 * cellSizeX;
+	region.east = tileRegion.west + (x1 + 1) * cellSizeX;
+	region.minRadius = mConfig.planetRadius + minElevation;
+	region.maxRadius = mConfig.planetRadius + maxElevation;
+
+	double tEnter, tExit;
+	if (!region.intersect(*context.ray, 0, context.getMaxDistance(), tEnter, tExit))
+	{
+		return;
+	}
+
+	if (level == 0)
+	{
+		// March against the whole tile's surface rather than just the block, so that crossings just outside the block's
+		// bounding volume are found with the same precision as crossings inside it.
+		marchCells(context, key, tile, texels, tileRegion, tEnter, tExit);
+		return;
+	}
+
+	// Visit child blocks front to back
+	struct Child
+	{
+		int x;
+		int y;
+		double distance;
+	};
+	Child children[4];
+	int childCount = 0;
+	for (int dy = 0; dy < 2; ++dy)
+	{
+		for (int dx = 0; dx < 2; ++dx)
+		{
+			Child& child = children[childCount];
+			child.x = blockX * 2 + dx;
+			child.y = blockY * 2 + dy;
+			if (child.x < pyramid.getBlockCountX(level - 1) && child.y < pyramid.getBlockCountY(level - 1))
+			{
+				int cellX = child.x * blockSize / 2 + blockSize / 4;
+				int cellY = child.y * blockSize / 2 + blockSize / 4;
+				LatLon centre = {tileRegion.south + cellY * cellSizeY, tileRegion.west + cellX * cellSizeX};
+				child.distance = (toUnitVector(centre.latitude, centre.longitude) * mConfig.planetRadius - context.ray->origin) * context.ray->direction;
+				++childCount;
+			}
+		}
+	}
+	std::sort(children, children + childCount, [](const Child& a, const Child& b) { return a.distance < b.distance; });
+
+	for (int i = 0; i < childCount; ++i)
+	{
+		raycastBlock(context, key, tile, texels, level - 1, children[i].x, children[i].y, minCellX, minCellY, maxCellX, maxCellY);
+	}
+}
+
+void TerrainRaycaster::marchCells(Context& context, const QuadTreeTileKey& key, const DecodedElevationTile& tile, const std::uint16_t* texels,
+	const Region& tileRegion, double tEnter, double tExit) const
+{
+	const TerrainRay& ray = *context.ray;
+
+	// @returns height of the ray above the terrain, or null if the ray is outside the tile at t
+	auto heightAboveTerrain = [&](double t) -> std::optional<double> {
+		osg::Vec3d position = ray.origin + ray.direction * t;
+		LatLon latLon = toLatLon(position);
+		double longitude = tileRegion.west + std::remainder(latLon.longitude - tileRegion.west, 2 * pi);
+		if (longitude < tileRegion.west)
+		{
+			longitude += 2 * pi;
+		}
+		if (latLon.latitude < tileRegion.south || latLon.latitude > tileRegion.north || longitude > tileRegion.east)
+		{
+			return std::nullopt;
+		}
+		return position.length() - mConfig.planetRadius - TerrainHeightQuery::sampleHeight(tile, texels, key, latLon);
+	};
+
+	// Step at half a cell so that features of the bilinear surface are not stepped over
+	const double cellSize = pi / (1 << key.level) / (tile.texels.getWidth() - 1);
+	const double step = std::max(1.0, 0.5 * cellSize * mConfig.planetRadius);
+
+	// Refines a crossing between a sample above the terrain (or outside the tile) and one below it by bisection
+	auto addHit = [&](double above, double below) {
+		for (int i = 0; i < 24; ++i)
+		{
+			double mid = (above + below) / 2;
+			std::optional<double> midHeight = heightAboveTerrain(mid);
+			if (!midHeight || *midHeight > 0)
+			{
+				above = mid;
+			}
+			else
+			{
+				below = mid;
+			}
+		}
+
+		if (below < context.getMaxDistance())
+		{
+			TerrainRayHit hit;
+			hit.distance = below;
+			osg::Vec3d position = ray.origin + ray.direction * below;
+			hit.position = toLatLon(position);
+			hit.height = TerrainHeightQuery::sampleHeight(tile, texels, key, hit.position);
+			context.hit = hit;
+		}
+	};
+
+	// Start a step early to catch crossings close to where the ray enters.
+	// Samples outside the tile count as above the terrain, since crossings there are found by the neighbouring tile.
+	std::optional<double> previousT;
+	bool previousInside = false;
+	for (double t = std::max(0.0, tEnter - step); t <= tExit + step; t += step)
+	{
+		double tClamped = std::min(t, tExit);
+		std::optional<double> height = heightAboveTerrain(tClamped);
+		if (height && *height <= 0)
+		{
+			if (previousT)
+			{
+				addHit(*previousT, tClamped);
+			}
+			else
+			{
+				addHit(tClamped, tClamped);
+			}
+			return;
+		}
+
+		if (!height && previousInside)
+		{
+			// The ray left the tile since the last sample. Find where, and check for a crossing before the edge.
+			double inside = *previousT;
+			double outside = tClamped;
+			for (int i = 0; i < 24; ++i)
+			{
+				double mid = (inside + outside) / 2;
+				if (heightAboveTerrain(mid))
+				{
+					inside = mid;
+				}
+				else
+				{
+					outside = mid;
+				}
+			}
+			if (std::optional<double> edgeHeight = heightAboveTerrain(inside); edgeHeight && *edgeHeight <= 0)
+			{
+				addHit(*previousT, inside);
+				return;
+			}
+		}
+
+		previousT = tClamped;
+		previousInside = height.has_value();
+
+		if (tClamped >= tExit)
+		{
+			break;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "OrbiterElevationTileSource.h"
+#include "TerrainHeightQuery.h"
+
+#include <osg/Vec3d>
+
+#include <optional>
+#include <vector>
+
+//! Ray in the planet's frame, with origin at the planet centre, y axis through the north pole, and x axis through longitude zero.
+struct TerrainRay
+{
+	osg::Vec3d origin;
+	osg::Vec3d direction; //!< Must be normalized
+	double maxDistance;
+};
+
+struct TerrainRayHit
+{
+	double distance; //!< Along the ray
+	LatLon position;
+	double height; //!< Terrain height above the planet radius
+};
+
+struct TerrainRaycasterConfig
+{
+	std::shared_ptr<const OrbiterElevationTileSource> source;
+	double planetRadius;
+	int maxLevel; //!< Highest skybolt level to descend to
+
+	//! Added to tile elevation bounds when deciding whether to descend into a tile.
+	//! A tile's bounds are computed from its own texels, so terrain in higher resolution descendants can exceed them.
+	//! The margin is a heuristic rather than a guaranteed bound, so peaks which exceed an ancestor's bounds by more than the margin can be missed.
+	double boundsMargin = 300;
+};
+
+//! Intersects rays with the terrain, for uses such as terrain following cameras and line of sight checks.
+//! The quadtree is walked front to back using tile elevation bounds, and tiles are descended into only where the ray passes through their bounds.
+//! Within a leaf tile, the tile's min/max pyramid is walked down to 8x8 cell blocks, where the ray is marched against the bilinear surface.
+//! Tiles are read from the source as needed, so may block on I/O.
+//! Results are approximate: tiles are culled using their own bounds plus a margin, since bounds of their descendants are not known,
+//! and the surface is sampled at half cell steps, so thin features can be stepped over.
+class TerrainRaycaster
+{
+public:
+	TerrainRaycaster(const TerrainRaycasterConfig& config);
+	~TerrainRaycaster();
+
+	//! @returns the nearest hit within the ray's max distance, if any
+	//!@ThreadSafe
+	std::optional<TerrainRayHit> raycast(const TerrainRay& ray) const;
+
+	//! Casts a batch of rays, expanding each tile's texels at most once per batch
+	//!@ThreadSafe
+	void raycast(const std::vector<TerrainRay>& rays, std::vector<std::optional<TerrainRayHit>>& hitsOut) const;
+
+private:
+	struct Context;
+	struct Region;
+
+	void raycastTile(Context& context, const skybolt::QuadTreeTileKey& key, const DecodedElevationTilePtr& tile) const;
+
+	//! Intersects the ray with the tile's own texels within the given inclusive cell rectangle
+	void raycastTexels(Context& context, const skybolt::QuadTreeTileKey& key, const DecodedElevationTilePtr& tile,
+		int minCellX, int minCellY, int maxCellX, int maxCellY) const;
+
+	void raycastBlock(Context& context, const skybolt::QuadTreeTileKey& key, const DecodedElevationTile& tile, const std::uint16_t* texels,
+		int level, int blockX, int blockY, int minCellX, int minCellY, int maxCellX, int maxCellY) const;
+
+	void marchCells(Context& context, const skybolt::QuadTreeTileKey& key, const DecodedElevationTile& tile, const std::uint16_t* texels,
+		const Region& tileRegion, double tEnter, double tExit) const;
+
+	Region getTileRegion(const skybolt::QuadTreeTileKey& key, double minElevation, double maxElevation) const;
+
+private:
+	const TerrainRaycasterConfig mConfig;
+};
@@ -0,0 +1,112 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <SkyboltCommon/Math/QuadTree.h>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+inline std::uint64_t toTileCacheKey(const skybolt::QuadTreeTileKey& key)
+{
+	return (std::uint64_t(key.level) << 56) | (std::uint64_t(key.y) << 28) | std::uint64_t(key.x);
+}
+
+//! Least recently used cache of decoded tiles.
+//! ValueT should be cheap to copy, e.g. a shared_ptr or ref_ptr.
+template <typename ValueT>
+class TileCache
+{
+public:
+	TileCache(std::size_t capacity) : mCapacity(capacity) {}
+
+	//!@ThreadSafe
+	std::optional<ValueT> get(const skybolt::QuadTreeTileKey& key)
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		auto i = mItems.find(toTileCacheKey(key));
+		if (i == mItems.end())
+		{
+			return std::nullopt;
+		}
+		mOrder.splice(mOrder.begin(), mOrder, i->second.orderIt);
+		return i->second.value;
+	}
+
+	//! Removes the tile from the cache
+	//! @returns the removed value, or nullopt if the tile was not cached
+	//!@ThreadSafe
+	std::optional<ValueT> take(const skybolt::QuadTreeTileKey& key)
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		auto i = mItems.find(toTileCacheKey(key));
+		if (i == mItems.end())
+		{
+			return std::nullopt;
+		}
+		ValueT value = std::move(i->second.value);
+		mOrder.erase(i->second.orderIt);
+		mItems.erase(i);
+		return value;
+	}
+
+	//!@ThreadSafe
+	void put(const skybolt::QuadTreeTileKey& key, const ValueT& value)
+	{
+		if (mCapacity == 0)
+		{
+			return;
+		}
+
+		std::scoped_lock<std::mutex> lock(mMutex);
+		std::uint64_t k = toTileCacheKey(key);
+		auto i = mItems.find(k);
+		if (i != mItems.end())
+		{
+			i->second.value = value;
+			mOrder.splice(mOrder.begin(), mOrder, i->second.orderIt);
+			return;
+		}
+
+		if (mItems.size() >= mCapacity)
+		{
+			mItems.erase(mOrder.back());
+			mOrder.pop_back();
+		}
+
+		mOrder.push_front(k);
+		mItems[k] = { value, mOrder.begin() };
+	}
+
+	//!@ThreadSafe
+	void clear()
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		mItems.clear();
+		mOrder.clear();
+	}
+
+private:
+	struct Item
+	{
+		ValueT value;
+		std::list<std::uint64_t>::iterator orderIt;
+	};
+
+	const std::size_t mCapacity;
+	std::mutex mMutex;
+	std::list<std::uint64_t> mOrder; //!< Most recently used at front
+	std::unordered_map<std::uint64_t, Item> mItems;
+};
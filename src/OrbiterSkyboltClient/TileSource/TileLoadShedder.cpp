@@ -0,0 +1,125 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TileLoadShedder.h"
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of each new latency sample in the moving average. Smooths out single slow reads without lagging a sustained backlog by more than a few dozen requests.
+static constexpr double latencySmoothing = 0.1;
+
+TileLoadShedder::TileLoadShedder(const TileLoadSheddingConfig& config) :
+	mConfig(config)
+{
+}
+
+void TileLoadShedder::requestStarted(int level)
+{
+	mInFlightRequestCount.fetch_add(1, std::memory_order_relaxed);
+
+	std::scoped_lock<std::mutex> lock(mMutex);
+	mMaxRequestedLevel = std::max(mMaxRequestedLevel, level);
+}
+
+void TileLoadShedder::requestFinished(std::chrono::steady_clock::duration latency)
+{
+	mInFlightRequestCount.fetch_sub(1, std::memory_order_relaxed);
+
+	double latencyMs = std::chrono::duration<double, std::milli>(latency).count();
+	auto now = std::chrono::steady_clock::now();
+
+	std::scoped_lock<std::mutex> lock(mMutex);
+	double recentLatencyMs = getDecayedLatencyMs(now);
+	mRecentLatencyMs = recentLatencyMs + (latencyMs - recentLatencyMs) * latencySmoothing;
+	mLastLatencySampleTime = now;
+	adjustLevelCap(now);
+}
+
+std::optional<int> TileLoadShedder::getLevelCap()
+{
+	int cap = mLevelCap.load(std::memory_order_relaxed);
+	if (cap == noCap)
+	{
+		return std::nullopt;
+	}
+
+	// Called for every tile availability query, so skip the re-evaluation rather than wait if another thread is adjusting the cap
+	if (std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock); lock)
+	{
+		adjustLevelCap(std::chrono::steady_clock::now());
+		cap = mLevelCap.load(std::memory_order_relaxed);
+	}
+	return (cap == noCap) ? std::nullopt : std::optional<int>(cap);
+}
+
+double TileLoadShedder::getRecentLatencyMs() const
+{
+	std::scoped_lock<std::mutex> lock(mMutex);
+	return getDecayedLatencyMs(std::chrono::steady_clock::now());
+}
+
+double TileLoadShedder::getDecayedLatencyMs(std::chrono::steady_clock::time_point now) const
+{
+	// Once the loader stops requesting tiles, the last samples would otherwise hold the average above the recovery threshold indefinitely
+	double halfLives = std::chrono::duration<double>(now - mLastLatencySampleTime) / std::chrono::duration<double>(mConfig.latencyHalfLife);
+	return mRecentLatencyMs * std::exp2(-std::max(0.0, halfLives));
+}
+
+void TileLoadShedder::adjustLevelCap(std::chrono::steady_clock::time_point now)
+{
+	int inFlightRequestCount = mInFlightRequestCount.load(std::memory_order_relaxed);
+	int cap = mLevelCap.load(std::memory_order_relaxed);
+	double recentLatencyMs = getDecayedLatencyMs(now);
+
+	// Thresholds for recovery are half those for backlog, so that the cap does not oscillate around a single threshold
+	bool backlogged = inFlightRequestCount > mConfig.maxInFlightRequests || recentLatencyMs > mConfig.maxLatencyMs;
+	bool clear = inFlightRequestCount <= mConfig.maxInFlightRequests / 2 && recentLatencyMs <= mConfig.maxLatencyMs / 2;
+
+	if (backlogged)
+	{
+		if (now - mLastAdjustTime < mConfig.capInterval)
+		{
+			return;
+		}
+
+		int newCap = std::max(mConfig.minLevelCap, ((cap == noCap) ? mMaxRequestedLevel : cap) - 1);
+		if (newCap != cap && (cap != noCap || newCap < mMaxRequestedLevel))
+		{
+			mLevelCap.store(newCap, std::memory_order_relaxed);
+			mLastAdjustTime = now;
+			BOOST_LOG_TRIVIAL(debug) << "Tile loading backlogged with " << inFlightRequestCount << " requests in flight and "
+				<< recentLatencyMs << " ms latency. Capping tile level at " << newCap << ".";
+		}
+	}
+	else if (clear && cap != noCap)
+	{
+		if (now - mLastAdjustTime < mConfig.recoveryInterval)
+		{
+			return;
+		}
+
+		int newCap = cap + 1;
+		if (newCap >= mMaxRequestedLevel)
+		{
+			mLevelCap.store(noCap, std::memory_order_relaxed);
+			mMaxRequestedLevel = 0;
+			BOOST_LOG_TRIVIAL(debug) << "Tile loading backlog cleared. Removing tile level cap.";
+		}
+		else
+		{
+			mLevelCap.store(newCap, std::memory_order_relaxed);
+		}
+		mLastAdjustTime = now;
+	}
+}
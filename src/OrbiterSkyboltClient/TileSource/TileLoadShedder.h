@@ -0,0 +1,79 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+struct TileLoadSheddingConfig
+{
+	int maxInFlightRequests = 24; //!< Requests in flight above which tile loading is considered backlogged
+	double maxLatencyMs = 150; //!< Recent mean request latency above which tile loading is considered backlogged
+	int minLevelCap = 6; //!< Served levels are never capped below this level
+	std::chrono::milliseconds capInterval{250}; //!< Min time between lowering the cap by a level
+	std::chrono::milliseconds recoveryInterval{1000}; //!< Min time between raising the cap by a level
+	std::chrono::milliseconds latencyHalfLife{500}; //!< Half life of the latency average's decay while no requests finish
+};
+
+//! Caps the level of tiles served while tile loading is backlogged, such as during fast flight, where fine tiles
+//! would be obsolete before they arrive. Sources then stop subdividing at the capped level and serve its tiles in place
+//! of finer ones, which are quicker to load and often already cached.
+//! The cap is lowered a level at a time while the backlog persists, and raised a level at a time once it clears,
+//! so that detail degrades and recovers gradually rather than all at once.
+//! A single shedder is shared by all tile sources of a session, since their requests compete for the same disk and threads.
+class TileLoadShedder
+{
+public:
+	TileLoadShedder(const TileLoadSheddingConfig& config);
+
+	//! Records the start of a request for a tile at the given level
+	//!@ThreadSafe
+	void requestStarted(int level);
+
+	//! Records the end of a request, whether or not it succeeded, and adjusts the cap
+	//!@ThreadSafe
+	void requestFinished(std::chrono::steady_clock::duration latency);
+
+	//! @returns the max level of tiles to serve, or nullopt if not capped.
+	//! Re-evaluates the cap while capped, so that it is raised once the backlog clears even if no further requests finish.
+	//!@ThreadSafe
+	std::optional<int> getLevelCap();
+
+	//!@ThreadSafe
+	int getInFlightRequestCount() const { return mInFlightRequestCount.load(std::memory_order_relaxed); }
+
+	//! @returns exponential moving average of request latency, which decays towards zero while no requests finish
+	//!@ThreadSafe
+	double getRecentLatencyMs() const;
+
+private:
+	//! Caller must hold mMutex
+	void adjustLevelCap(std::chrono::steady_clock::time_point now);
+
+	//! Caller must hold mMutex
+	double getDecayedLatencyMs(std::chrono::steady_clock::time_point now) const;
+
+private:
+	static constexpr int noCap = -1;
+
+	const TileLoadSheddingConfig mConfig;
+	std::atomic<int> mInFlightRequestCount = 0;
+	std::atomic<int> mLevelCap = noCap; //!< Read without locking, since it is checked on every tile availability query
+
+	mutable std::mutex mMutex;
+	double mRecentLatencyMs = 0; //!< As of mLastLatencySampleTime
+	std::chrono::steady_clock::time_point mLastLatencySampleTime;
+	int mMaxRequestedLevel = 0; //!< Highest level requested since the cap was last lifted
+	std::chrono::steady_clock::time_point mLastAdjustTime;
+};
@@ -0,0 +1,72 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TileSourceStats.h"
+
+#include <nlohmann/json.hpp>
+
+static double toMilliseconds(const TileSourceStats::Counter& counterNs)
+{
+	return double(counterNs.load(std::memory_order_relaxed)) * 1e-6;
+}
+
+nlohmann::json TileSourceStats::toJson() const
+{
+	nlohmann::json json;
+	json["name"] = name;
+	json["requestCount"] = requestCount.load(std::memory_order_relaxed);
+	json["cancelledCount"] = cancelledCount.load(std::memory_order_relaxed);
+	json["bytesRead"] = bytesRead.load(std::memory_order_relaxed);
+	json["bytesInflated"] = bytesInflated.load(std::memory_order_relaxed);
+	json["lockWaitMs"] = toMilliseconds(lockWaitNs);
+	json["readMs"] = toMilliseconds(readNs);
+	json["inflateMs"] = toMilliseconds(inflateNs);
+	json["decodeMs"] = toMilliseconds(decodeNs);
+	json["inFlightRequestCount"] = inFlightRequestCount.load(std::memory_order_relaxed);
+	json["requestLatencyMs"] = toMilliseconds(requestLatencyNs);
+	json["cappedRequestCount"] = cappedRequestCount.load(std::memory_order_relaxed);
+
+	// Only levels with cache activity are written, keyed by skybolt level
+	nlohmann::json cache = nlohmann::json::object();
+	for (int level = 0; level < maxLevelCount; ++level)
+	{
+		std::uint64_t hits = cacheHits[level].load(std::memory_order_relaxed);
+		std::uint64_t misses = cacheMisses[level].load(std::memory_order_relaxed);
+		if (hits || misses)
+		{
+			cache[std::to_string(level)] = {{"hits", hits}, {"misses", misses}};
+		}
+	}
+	json["cacheByLevel"] = cache;
+	return json;
+}
+
+void TileSourceStatsRegistry::add(const TileSourceStatsPtr& stats)
+{
+	std::scoped_lock<std::mutex> lock(mMutex);
+	mStats.push_back(stats);
+}
+
+std::vector<TileSourceStatsPtr> TileSourceStatsRegistry::getStats() const
+{
+	std::scoped_lock<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+nlohmann::json TileSourceStatsRegistry::toJson() const
+{
+	nlohmann::json json = nlohmann::json::array();
+	for (const TileSourceStatsPtr& stats : getStats())
+	{
+		json.push_back(stats->toJson());
+	}
+	return json;
+}
@@ -0,0 +1,106 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//! Counters for a tile source's loading pipeline.
+//! Counters are updated with relaxed atomics so that recording does not contend between loader threads.
+struct TileSourceStats
+{
+	TileSourceStats(const std::string& name) : name(name) {}
+
+	using Counter = std::atomic<std::uint64_t>;
+
+	const std::string name;
+
+	Counter requestCount = 0;
+	Counter cancelledCount = 0;
+	Counter bytesRead = 0; //!< Compressed bytes read from the archive
+	Counter bytesInflated = 0;
+
+	Counter lockWaitNs = 0; //!< Time spent waiting for access to the archive
+	Counter readNs = 0;
+	Counter inflateNs = 0;
+	Counter decodeNs = 0;
+
+	Counter inFlightRequestCount = 0; //!< Requests currently being served, giving the depth of the source's queue
+	Counter requestLatencyNs = 0; //!< Total time from the start to the end of requests
+	Counter cappedRequestCount = 0; //!< Availability queries answered with a coarser tile because of the load shedder's level cap
+
+	static constexpr int maxLevelCount = 24;
+	std::array<Counter, maxLevelCount> cacheHits = {};
+	std::array<Counter, maxLevelCount> cacheMisses = {};
+
+	static void add(Counter& counter, std::uint64_t value) { counter.fetch_add(value, std::memory_order_relaxed); }
+	static void subtract(Counter& counter, std::uint64_t value) { counter.fetch_sub(value, std::memory_order_relaxed); }
+
+	void addCacheHit(int level) { add(cacheHits[clampLevel(level)], 1); }
+	void addCacheMiss(int level) { add(cacheMisses[clampLevel(level)], 1); }
+
+	//!@ThreadSafe
+	nlohmann::json toJson() const;
+
+private:
+	static int clampLevel(int level) { return level < 0 ? 0 : (level >= maxLevelCount ? maxLevelCount - 1 : level); }
+};
+
+using TileSourceStatsPtr = std::shared_ptr<TileSourceStats>;
+
+//! Adds the time elapsed during the timer's lifetime to a counter
+class ScopedStatTimer
+{
+public:
+	ScopedStatTimer(TileSourceStats::Counter& counterNs) :
+		mCounterNs(counterNs),
+		mStartTime(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ScopedStatTimer()
+	{
+		auto elapsed = std::chrono::steady_clock::now() - mStartTime;
+		TileSourceStats::add(mCounterNs, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+private:
+	TileSourceStats::Counter& mCounterNs;
+	std::chrono::steady_clock::time_point mStartTime;
+};
+
+//! Collects the stats of all tile sources created during a session.
+//! Stats are retained after their tile source is destroyed so that they can be dumped at the end of the session.
+class TileSourceStatsRegistry
+{
+public:
+	//!@ThreadSafe
+	void add(const TileSourceStatsPtr& stats);
+
+	//!@ThreadSafe
+	std::vector<TileSourceStatsPtr> getStats() const;
+
+	//!@ThreadSafe
+	nlohmann::json toJson() const;
+
+private:
+	mutable std::mutex mMutex;
+	std::vector<TileSourceStatsPtr> mStats;
+};
@@ -0,0 +1,91 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TileWorkerPool.h"
+
+#include <algorithm>
+#include <assert.h>
+
+static thread_local const TileWorkerPool* currentPool = nullptr;
+
+TileWorkerPool::TileWorkerPool(int threadCount)
+{
+	assert(threadCount > 0);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		mThreads.emplace_back([this] { run(); });
+	}
+}
+
+TileWorkerPool::~TileWorkerPool()
+{
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		mStopping = true;
+		mTasks.clear();
+	}
+	mCondition.notify_all();
+
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+bool TileWorkerPool::isPoolThread() const
+{
+	return currentPool == this;
+}
+
+std::vector<TileWorkerPool::IndexRange> TileWorkerPool::splitIntoTaskRanges(std::uint32_t itemCount, std::uint32_t minItemsPerTask) const
+{
+	// Several tasks per thread, so that threads which finish early can take the remainder
+	std::uint32_t itemsPerTask = std::max(std::max(minItemsPerTask, std::uint32_t(1)), itemCount / std::uint32_t(getThreadCount() * 4) + 1);
+
+	std::vector<IndexRange> ranges;
+	for (std::uint32_t begin = 0; begin < itemCount;)
+	{
+		std::uint32_t end = begin + std::min(itemsPerTask, itemCount - begin);
+		ranges.push_back({begin, end});
+		begin = end;
+	}
+	return ranges;
+}
+
+void TileWorkerPool::submit(Task task)
+{
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		mTasks.push_back(std::move(task));
+	}
+	mCondition.notify_one();
+}
+
+void TileWorkerPool::run()
+{
+	currentPool = this;
+
+	for (;;)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+			if (mStopping)
+			{
+				return;
+			}
+			task = std::move(mTasks.front());
+			mTasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,60 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! Runs background tile work, such as prefetching, parsing and validation, off the render thread.
+//! Must not be created from DllMain(), where creating threads is illegal.
+class TileWorkerPool
+{
+public:
+	TileWorkerPool(int threadCount);
+	~TileWorkerPool(); //!< Waits for running tasks to finish. Tasks still queued are discarded.
+
+	using Task = std::function<void()>;
+
+	//!@ThreadSafe
+	void submit(Task task);
+
+	//! @returns true if the calling thread belongs to this pool
+	bool isPoolThread() const;
+
+	int getThreadCount() const { return int(mThreads.size()); }
+
+	//! Half open range of item indices processed by one task
+	struct IndexRange
+	{
+		std::uint32_t begin;
+		std::uint32_t end;
+	};
+
+	//! Splits items [0, itemCount) into enough ranges to balance load across the pool.
+	//! Every range except the last has at least minItemsPerTask items.
+	std::vector<IndexRange> splitIntoTaskRanges(std::uint32_t itemCount, std::uint32_t minItemsPerTask) const;
+
+private:
+	void run();
+
+private:
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<Task> mTasks;
+	bool mStopping = false;
+};
@@ -0,0 +1,159 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+//! Checks of a tree archive's table of contents and data blocks, independent of how the archive is read.
+//! TocT provides size(), NodeSizeInflated(idx) and operator[](idx) returning a node with pos and child[4], as ZTreeMgr's TreeTOC does.
+
+constexpr std::uint32_t noTreeNode = std::uint32_t(-1);
+
+struct TreeDataLimits
+{
+	std::int64_t dataLength; //!< Length of the archive's data block
+	std::optional<std::int64_t> availableDataLength; //!< Length of the data block present in the file, or nullopt if unknown
+};
+
+struct TreeBlockBounds
+{
+	std::int64_t begin; //!< Offset relative to start of data block
+	std::int64_t end;
+};
+
+//! Called with each bad node found and the reason it is bad
+using TreeBadNodeHandler = std::function<void(std::uint32_t idx, const std::string& reason)>;
+
+//! @returns block bounds of the node if they are consistent with the archive, otherwise nullopt with reasonOut set
+template <typename TocT>
+std::optional<TreeBlockBounds> getTreeBlockBounds(const TocT& toc, std::uint32_t idx, const TreeDataLimits& limits, std::string& reasonOut)
+{
+	TreeBlockBounds bounds;
+	bounds.begin = toc[idx].pos;
+	bounds.end = (idx + 1 < toc.size()) ? toc[idx + 1].pos : limits.dataLength;
+
+	if (bounds.begin < 0 || bounds.begin >= limits.dataLength)
+	{
+		reasonOut = "data offset outside of data block";
+		return std::nullopt;
+	}
+	if (bounds.end <= bounds.begin || bounds.end > limits.dataLength)
+	{
+		reasonOut = "data size inconsistent with next node";
+		return std::nullopt;
+	}
+	if (limits.availableDataLength && bounds.end > *limits.availableDataLength)
+	{
+		reasonOut = "data extends beyond end of file";
+		return std::nullopt;
+	}
+	return bounds;
+}
+
+//! Checks that child indices are in range, that every node has at most one parent, and that node data blocks lie within the archive.
+//! @param rootIndices are the nodes referenced by the archive header, which parents the root nodes. Absent roots are noTreeNode.
+template <typename TocT>
+void checkTreeStructure(const TocT& toc, const std::vector<std::uint32_t>& rootIndices, const TreeDataLimits& limits, const TreeBadNodeHandler& addBadNode)
+{
+	std::uint32_t nodeCount = toc.size();
+	std::vector<std::uint8_t> parentCounts(nodeCount, 0);
+	auto addReference = [&](std::uint32_t referencingIdx, std::uint32_t idx) {
+		if (idx == noTreeNode)
+		{
+			return;
+		}
+		if (idx >= nodeCount)
+		{
+			addBadNode(referencingIdx, "child index out of range");
+		}
+		else if (++parentCounts[idx] > 1)
+		{
+			addBadNode(idx, "node referenced by more than one parent");
+		}
+	};
+
+	for (std::uint32_t idx : rootIndices)
+	{
+		addReference(noTreeNode, idx);
+	}
+
+	for (std::uint32_t idx = 0; idx < nodeCount; ++idx)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			addReference(idx, toc[idx].child[c]);
+		}
+
+		if (toc.NodeSizeInflated(idx) != 0)
+		{
+			std::string reason;
+			if (!getTreeBlockBounds(toc, idx, limits, reason))
+			{
+				addBadNode(idx, reason);
+			}
+		}
+	}
+}
+
+//! Reads sizeBytes of the data block at the offset relative to the start of the data block.
+//! @returns false if the data could not be read
+using TreeBlockReader = std::function<bool(std::int64_t offset, std::uint32_t sizeBytes, std::uint8_t* out)>;
+
+//! @returns inflated size, which is expected to be outSizeBytes
+using TreeBlockInflater = std::function<std::uint32_t(const std::uint8_t* data, std::uint32_t sizeBytes, std::uint8_t* out, std::uint32_t outSizeBytes)>;
+
+//! Checks that the data blocks of nodes [beginIdx, endIdx) can be read and inflate to their expected size.
+//! Blocks with inconsistent bounds are skipped, since checkTreeStructure() reports them.
+//! @returns number of blocks checked
+template <typename TocT>
+std::uint32_t checkTreeBlocks(const TocT& toc, std::uint32_t beginIdx, std::uint32_t endIdx, const TreeDataLimits& limits,
+	const TreeBlockReader& read, const TreeBlockInflater& inflate, const TreeBadNodeHandler& addBadNode)
+{
+	std::vector<std::uint8_t> zbuf;
+	std::vector<std::uint8_t> ebuf;
+	std::uint32_t checkedBlockCount = 0;
+
+	for (std::uint32_t idx = beginIdx; idx < endIdx; ++idx)
+	{
+		std::uint32_t esize = toc.NodeSizeInflated(idx);
+		if (esize == 0)
+		{
+			continue;
+		}
+
+		std::string reason;
+		std::optional<TreeBlockBounds> bounds = getTreeBlockBounds(toc, idx, limits, reason);
+		if (!bounds)
+		{
+			continue;
+		}
+
+		std::uint32_t zsize = std::uint32_t(bounds->end - bounds->begin);
+		zbuf.resize(zsize);
+		ebuf.resize(esize);
+
+		if (!read(bounds->begin, zsize, zbuf.data()))
+		{
+			addBadNode(idx, "read failed");
+		}
+		else if (inflate(zbuf.data(), zsize, ebuf.data(), esize) != esize)
+		{
+			addBadNode(idx, "inflate failed");
+		}
+		++checkedBlockCount;
+	}
+	return checkedBlockCount;
+}
@@ -0,0 +1,197 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TreeArchiveValidator.h"
+#include "TreeArchiveChecks.h"
+#include "TileWorkerPool.h"
+#include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
+
+#include <OrbiterAPI.h>
+
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <stdio.h>
+
+namespace {
+
+struct ValidationJob
+{
+	std::shared_ptr<const ZTreeMgr> treeMgr;
+	std::shared_ptr<BadTreeNodes> badNodes;
+	TreeArchiveReportHandler reportHandler;
+	TreeDataLimits limits;
+
+	std::mutex reportMutex;
+	TreeArchiveReport report;
+	std::atomic<int> remainingTasks = 0;
+
+	void addError(const std::string& error, std::uint32_t uncheckedBlockCount)
+	{
+		std::scoped_lock<std::mutex> lock(reportMutex);
+		if (std::find(report.errors.begin(), report.errors.end(), error) == report.errors.end())
+		{
+			report.errors.push_back(error);
+		}
+		report.uncheckedBlockCount += uncheckedBlockCount;
+	}
+
+	void addBadNode(DWORD idx, const std::string& reason)
+	{
+		badNodes->insert(idx);
+		std::scoped_lock<std::mutex> lock(reportMutex);
+		report.badNodes.push_back({idx, reason});
+	}
+
+	void taskFinished()
+	{
+		if (--remainingTasks == 0)
+		{
+			std::sort(report.badNodes.begin(), report.badNodes.end(), [](const auto& a, const auto& b) { return a.idx < b.idx; });
+			reportHandler(report);
+		}
+	}
+};
+
+void validateStructure(ValidationJob& job)
+{
+	const ZTreeMgr& treeMgr = *job.treeMgr;
+	std::vector<std::uint32_t> rootIndices = {
+		treeMgr.Idx(1, 0, 0),
+		treeMgr.Idx(2, 0, 0),
+		treeMgr.Idx(3, 0, 0),
+		treeMgr.Idx(4, 0, 0),
+		treeMgr.Idx(4, 0, 1)
+	};
+
+	checkTreeStructure(treeMgr.TOC(), rootIndices, job.limits, [&](std::uint32_t idx, const std::string& reason) {
+		job.addBadNode(idx, reason);
+	});
+}
+
+void validateBlocks(ValidationJob& job, DWORD beginIdx, DWORD endIdx)
+{
+	const TreeTOC& toc = job.treeMgr->TOC();
+
+	FILE* file = fopen(job.treeMgr->ArchiveName(), "rb");
+	if (!file)
+	{
+		std::uint32_t uncheckedBlockCount = 0;
+		for (DWORD idx = beginIdx; idx < endIdx; ++idx)
+		{
+			uncheckedBlockCount += (toc.NodeSizeInflated(idx) != 0);
+		}
+		job.addError("could not open archive for reading", uncheckedBlockCount);
+		return;
+	}
+
+	__int64 dataOffset = job.treeMgr->DataOffset();
+	auto read = [&](std::int64_t offset, std::uint32_t sizeBytes, std::uint8_t* out) {
+		return _fseeki64(file, dataOffset + offset, SEEK_SET) == 0 && fread(out, 1, sizeBytes, file) == sizeBytes;
+	};
+	auto inflate = [](const std::uint8_t* data, std::uint32_t sizeBytes, std::uint8_t* out, std::uint32_t outSizeBytes) {
+		return std::uint32_t(oapiInflate(data, sizeBytes, out, outSizeBytes));
+	};
+
+	std::uint32_t checkedBlockCount = checkTreeBlocks(toc, beginIdx, endIdx, job.limits, read, inflate, [&](std::uint32_t idx, const std::string& reason) {
+		job.addBadNode(idx, reason);
+	});
+
+	fclose(file);
+
+	std::scoped_lock<std::mutex> lock(job.reportMutex);
+	job.report.checkedBlockCount += checkedBlockCount;
+}
+
+std::optional<__int64> getFileSize(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+	{
+		return std::nullopt;
+	}
+	_fseeki64(file, 0, SEEK_END);
+	__int64 size = _ftelli64(file);
+	fclose(file);
+	return size;
+}
+
+} // namespace
+
+void validateTreeArchive(TileWorkerPool& workerPool, const std::shared_ptr<const ZTreeMgr>& treeMgr,
+	const std::shared_ptr<BadTreeNodes>& badNodes, TreeArchiveReportHandler reportHandler)
+{
+	auto job = std::make_shared<ValidationJob>();
+	job->treeMgr = treeMgr;
+	job->badNodes = badNodes;
+	job->reportHandler = std::move(reportHandler);
+	job->report.archiveName = treeMgr->ArchiveName();
+	job->report.nodeCount = treeMgr->TOC().size();
+	job->limits.dataLength = treeMgr->DataLength();
+	if (std::optional<__int64> fileSize = getFileSize(treeMgr->ArchiveName()); fileSize)
+	{
+		job->limits.availableDataLength = *fileSize - treeMgr->DataOffset();
+	}
+	else
+	{
+		job->report.errors.push_back("could not determine archive size, so block bounds were not checked against it");
+	}
+
+	constexpr std::uint32_t minNodesPerTask = 256;
+	std::vector<TileWorkerPool::IndexRange> blockRanges = workerPool.splitIntoTaskRanges(std::uint32_t(job->report.nodeCount), minNodesPerTask);
+
+	job->remainingTasks = 1 + int(blockRanges.size());
+
+	workerPool.submit([job] {
+		validateStructure(*job);
+		job->taskFinished();
+	});
+
+	for (const TileWorkerPool::IndexRange& range : blockRanges)
+	{
+		workerPool.submit([job, range] {
+			validateBlocks(*job, range.begin, range.end);
+			job->taskFinished();
+		});
+	}
+}
+
+void logTreeArchiveReport(const TreeArchiveReport& report)
+{
+	for (const std::string& error : report.errors)
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Could not fully validate tile archive '" << report.archiveName << "': " << error;
+	}
+	if (report.uncheckedBlockCount > 0)
+	{
+		BOOST_LOG_TRIVIAL(warning) << "Tile archive '" << report.archiveName << "' has " << report.uncheckedBlockCount << " unchecked blocks";
+	}
+
+	if (report.badNodes.empty())
+	{
+		if (report.errors.empty())
+		{
+			BOOST_LOG_TRIVIAL(info) << "Validated tile archive '" << report.archiveName << "': " << report.checkedBlockCount << " blocks OK";
+		}
+		return;
+	}
+
+	BOOST_LOG_TRIVIAL(warning) << "Tile archive '" << report.archiveName << "' has " << report.badNodes.size() << " bad nodes out of "
+		<< report.nodeCount << ". Bad nodes will be skipped.";
+
+	constexpr size_t maxLoggedNodes = 20;
+	for (size_t i = 0; i < std::min(maxLoggedNodes, report.badNodes.size()); ++i)
+	{
+		BOOST_LOG_TRIVIAL(warning) << "  Node " << report.badNodes[i].idx << ": " << report.badNodes[i].reason;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class TileWorkerPool;
+class ZTreeMgr;
+
+//! Set of tree nodes whose data is known to be unreadable, so that they can be skipped rather than read again
+class BadTreeNodes
+{
+public:
+	//!@ThreadSafe
+	bool contains(std::uint32_t idx) const
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		return mNodes.find(idx) != mNodes.end();
+	}
+
+	//!@ThreadSafe
+	void insert(std::uint32_t idx)
+	{
+		std::scoped_lock<std::mutex> lock(mMutex);
+		mNodes.insert(idx);
+	}
+
+private:
+	mutable std::mutex mMutex;
+	std::unordered_set<std::uint32_t> mNodes;
+};
+
+struct TreeArchiveReport
+{
+	std::string archiveName;
+	std::uint32_t nodeCount = 0;
+	std::uint32_t checkedBlockCount = 0;
+	std::uint32_t uncheckedBlockCount = 0; //!< Blocks which could not be checked because of errors
+	std::vector<std::string> errors; //!< Problems which prevented the archive from being fully validated
+
+	struct BadNode
+	{
+		std::uint32_t idx;
+		std::string reason;
+	};
+	std::vector<BadNode> badNodes;
+};
+
+using TreeArchiveReportHandler = std::function<void(const TreeArchiveReport&)>;
+
+//! Validates a tree archive on the worker pool without blocking the caller.
+//! Checks TOC consistency, checks node data blocks lie within the archive, and checks that each block inflates to its expected size.
+//! Bad nodes are added to badNodes as they are found, and reportHandler is called from a worker thread once validation is complete.
+void validateTreeArchive(TileWorkerPool& workerPool, const std::shared_ptr<const ZTreeMgr>& treeMgr,
+	const std::shared_ptr<BadTreeNodes>& badNodes, TreeArchiveReportHandler reportHandler);
+
+//! Logs a summary of the report
+void logTreeArchiveReport(const TreeArchiveReport& report);
@@ -0,0 +1,68 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "UnbufferedFile.h"
+
+#include <Windows.h>
+
+#include <assert.h>
+
+std::unique_ptr<UnbufferedFile> UnbufferedFile::open(const std::string& filename)
+{
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	return std::unique_ptr<UnbufferedFile>(new UnbufferedFile(handle));
+}
+
+UnbufferedFile::UnbufferedFile(void* handle) :
+	mHandle(handle)
+{
+}
+
+UnbufferedFile::~UnbufferedFile()
+{
+	CloseHandle(mHandle);
+}
+
+bool UnbufferedFile::read(std::int64_t offset, std::size_t sizeBytes, AlignedBufferPool& pool, AlignedBufferPool::Buffer& bufferOut, const std::uint8_t*& dataOut) const
+{
+	assert(pool.getAlignment() % unbufferedIoAlignment == 0);
+
+	// Unbuffered reads must start and end on sector boundaries
+	std::int64_t alignedOffset = offset & ~std::int64_t(unbufferedIoAlignment - 1);
+	std::size_t leadingBytes = std::size_t(offset - alignedOffset);
+	std::size_t alignedSize = (leadingBytes + sizeBytes + unbufferedIoAlignment - 1) & ~(unbufferedIoAlignment - 1);
+
+	bufferOut = pool.acquire(alignedSize);
+	if (!bufferOut.data())
+	{
+		return false;
+	}
+
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = DWORD(alignedOffset);
+	overlapped.OffsetHigh = DWORD(alignedOffset >> 32);
+
+	// The final read of the file may return fewer bytes than requested, which is fine as long as the requested range was read
+	DWORD bytesRead = 0;
+	if (!ReadFile(mHandle, bufferOut.data(), DWORD(alignedSize), &bytesRead, &overlapped) || bytesRead < leadingBytes + sizeBytes)
+	{
+		return false;
+	}
+
+	dataOut = bufferOut.data() + leadingBytes;
+	return true;
+}
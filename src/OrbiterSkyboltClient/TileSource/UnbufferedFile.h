@@ -0,0 +1,44 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#pragma once
+
+#include "AlignedBufferPool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//! Alignment of unbuffered reads. A multiple of the sector size of all common storage devices.
+constexpr std::size_t unbufferedIoAlignment = 4096;
+
+//! Read-only file opened with OS caching disabled, so that reads bypass the page cache.
+//! Reads are positional rather than sharing a file pointer, so may be made concurrently.
+class UnbufferedFile
+{
+public:
+	//! @returns null if the file could not be opened
+	static std::unique_ptr<UnbufferedFile> open(const std::string& filename);
+
+	~UnbufferedFile();
+
+	//! Reads a range of the file into a buffer from the pool, expanding the range to aligned boundaries as required.
+	//! @param dataOut is set to the start of the requested range within bufferOut
+	//! @returns false if the read failed
+	//!@ThreadSafe
+	bool read(std::int64_t offset, std::size_t sizeBytes, AlignedBufferPool& pool, AlignedBufferPool::Buffer& bufferOut, const std::uint8_t*& dataOut) const;
+
+private:
+	UnbufferedFile(void* handle);
+
+private:
+	void* mHandle;
+};
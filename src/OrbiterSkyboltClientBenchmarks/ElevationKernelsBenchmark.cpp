@@ -0,0 +1,69 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "TileSource/ElevationKernels.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//! Times cropping and biasing the inner 257x257 texels of a 259x259 Orbiter elevation tile
+template <typename SourceT, typename BiasFunction>
+static double timeTileMicroseconds(const std::vector<SourceT>& source, BiasFunction bias)
+{
+	constexpr int sourceWidth = 259;
+	constexpr int width = 257;
+	constexpr int iterationCount = 2000;
+
+	std::vector<std::uint16_t> out(width * width);
+	ElevationTexelBounds bounds;
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterationCount; ++i)
+	{
+		for (int y = 0; y < width; ++y)
+		{
+			bias(source.data() + (y + 1) * sourceWidth + 1, out.data() + y * width, width, bounds);
+		}
+	}
+	auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+	// Use the result so that the work is not optimized away
+	if (bounds.isEmpty())
+	{
+		std::cerr << "Unexpected empty bounds" << std::endl;
+	}
+	return std::chrono::duration<double, std::micro>(elapsed).count() / iterationCount;
+}
+
+template <typename SourceT>
+static void benchmark(const char* name)
+{
+	std::mt19937 rng(1);
+	std::vector<SourceT> source(259 * 259);
+	for (SourceT& texel : source)
+	{
+		texel = SourceT(rng());
+	}
+
+	using Function = void(*)(const SourceT*, std::uint16_t*, int, ElevationTexelBounds&);
+	double scalar = timeTileMicroseconds(source, Function(&biasElevationRowScalar));
+	double vectorized = timeTileMicroseconds(source, Function(&biasElevationRow));
+	std::cout << name << ": scalar " << scalar << " us/tile, vectorized " << vectorized << " us/tile, speedup " << scalar / vectorized << "x" << std::endl;
+}
+
+int main()
+{
+	benchmark<std::uint8_t>("uint8");
+	benchmark<std::int16_t>("int16");
+	return 0;
+}
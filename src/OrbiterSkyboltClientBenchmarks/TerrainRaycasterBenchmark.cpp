@@ -0,0 +1,93 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "TileSource/TerrainRaycaster.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr double pi = 3.14159265358979323846;
+
+//! Creates rays from random points above the planet, looking down at shallow angles as a terrain following camera would
+static std::vector<TerrainRay> createRays(double planetRadius, int count)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+	std::vector<TerrainRay> rays(count);
+	for (TerrainRay& ray : rays)
+	{
+		double latitude = std::asin(2 * unit(rng) - 1);
+		double longitude = (2 * unit(rng) - 1) * pi;
+		osg::Vec3d up(std::cos(latitude) * std::cos(longitude), std::sin(latitude), std::cos(latitude) * std::sin(longitude));
+
+		// Tangent direction at a random azimuth, tilted down
+		osg::Vec3d east = osg::Vec3d(0, 1, 0) ^ up;
+		if (east.normalize() == 0)
+		{
+			east = osg::Vec3d(1, 0, 0);
+		}
+		osg::Vec3d north = up ^ east;
+		double azimuth = 2 * pi * unit(rng);
+		double pitch = -0.05 - 0.5 * unit(rng);
+		osg::Vec3d tangent = north * std::cos(azimuth) + east * std::sin(azimuth);
+
+		ray.origin = up * (planetRadius + 10000);
+		ray.direction = tangent * std::cos(pitch) + up * std::sin(pitch);
+		ray.direction.normalize();
+		ray.maxDistance = 200000;
+	}
+	return rays;
+}
+
+//! @returns rays cast per second
+static double timeRaycasts(const TerrainRaycaster& raycaster, const std::vector<TerrainRay>& rays, int& hitCountOut)
+{
+	std::vector<std::optional<TerrainRayHit>> hits;
+	auto startTime = std::chrono::steady_clock::now();
+	raycaster.raycast(rays, hits);
+	auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+	hitCountOut = int(std::count_if(hits.begin(), hits.end(), [](const std::optional<TerrainRayHit>& hit) { return hit.has_value(); }));
+	return rays.size() / std::chrono::duration<double>(elapsed).count();
+}
+
+//! Measures raycast throughput against a planet's elevation archive.
+//! Usage: TerrainRaycasterBenchmark <planet texture directory> [planet radius in meters] [max level]
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: TerrainRaycasterBenchmark <planet texture directory> [planet radius in meters] [max level]" << std::endl;
+		return 1;
+	}
+
+	TerrainRaycasterConfig config;
+	config.source = std::make_shared<OrbiterElevationTileSource>(argv[1]);
+	config.planetRadius = (argc > 2) ? std::stod(argv[2]) : 6371010.0;
+	config.maxLevel = (argc > 3) ? std::stoi(argv[3]) : 10;
+	TerrainRaycaster raycaster(config);
+
+	std::vector<TerrainRay> rays = createRays(config.planetRadius, 1000);
+
+	// The first pass reads tiles from the archive, and the second finds them in the tile cache
+	int hitCount;
+	double coldRate = timeRaycasts(raycaster, rays, hitCount);
+	double warmRate = timeRaycasts(raycaster, rays, hitCount);
+	std::cout << "Cold: " << coldRate << " rays/s, warm: " << warmRate << " rays/s, " << hitCount << " of " << rays.size() << " rays hit" << std::endl;
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "OrbiterSkyboltClient/ThirdParty/ztreemgr.h"
+#include "TileSource/AlignedBufferPool.h"
+#include "TileSource/UnbufferedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReadResult
+{
+	double seconds = 0;
+	std::uint64_t bytes = 0;
+	int failedCount = 0;
+};
+
+static void printResult(const std::string& name, const ReadResult& result, std::size_t nodeCount)
+{
+	std::cout << name << ": " << (nodeCount / result.seconds) << " reads/s, " << (result.bytes / result.seconds / (1024 * 1024)) << " MB/s";
+	if (result.failedCount > 0)
+	{
+		std::cout << ", " << result.failedCount << " failed";
+	}
+	std::cout << std::endl;
+}
+
+//! @returns a random sample of nodes with data, in random order as a quadtree traversal over a large area would read them
+static std::vector<DWORD> sampleNodes(const ZTreeMgr& treeMgr, std::size_t count)
+{
+	std::vector<DWORD> nodes;
+	for (DWORD idx = 0; idx < treeMgr.TOC().size(); ++idx)
+	{
+		if (treeMgr.NodeSizeInflated(idx) != 0)
+		{
+			nodes.push_back(idx);
+		}
+	}
+
+	std::mt19937 rng(1);
+	std::shuffle(nodes.begin(), nodes.end(), rng);
+	nodes.resize(std::min(count, nodes.size()));
+	return nodes;
+}
+
+//! Reads through the tree manager, which requires exclusive access, so reads are serialized as in the tile sources' buffered mode
+static ReadResult readBuffered(ZTreeMgr& treeMgr, const std::vector<DWORD>& nodes)
+{
+	ReadResult result;
+	auto startTime = std::chrono::steady_clock::now();
+	for (DWORD idx : nodes)
+	{
+		BYTE* data;
+		DWORD sizeBytes = treeMgr.ReadDeflatedData(idx, &data);
+		if (sizeBytes == 0)
+		{
+			++result.failedCount;
+			continue;
+		}
+		result.bytes += sizeBytes;
+		treeMgr.ReleaseData(data);
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return result;
+}
+
+//! Reads with positional unbuffered reads, concurrently from threadCount threads as in the tile sources' unbuffered mode
+static ReadResult readUnbuffered(const UnbufferedFile& file, const ZTreeMgr& treeMgr, const std::vector<DWORD>& nodes, int threadCount)
+{
+	auto pool = std::make_shared<AlignedBufferPool>(unbufferedIoAlignment, 64 * 1024 * 1024);
+	std::vector<ReadResult> threadResults(threadCount);
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t] {
+			ReadResult& result = threadResults[t];
+			for (std::size_t i = t; i < nodes.size(); i += threadCount)
+			{
+				DWORD idx = nodes[i];
+				DWORD sizeBytes = treeMgr.NodeSizeDeflated(idx);
+				AlignedBufferPool::Buffer buffer;
+				const std::uint8_t* data;
+				if (!file.read(treeMgr.DataOffset() + treeMgr.TOC()[idx].pos, sizeBytes, *pool, buffer, data))
+				{
+					++result.failedCount;
+					continue;
+				}
+				result.bytes += sizeBytes;
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	ReadResult result;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	for (const ReadResult& threadResult : threadResults)
+	{
+		result.bytes += threadResult.bytes;
+		result.failedCount += threadResult.failedCount;
+	}
+	return result;
+}
+
+static ZTreeMgr::Layer parseLayer(const std::string& name)
+{
+	if (name == "mask")
+	{
+		return ZTreeMgr::LAYER_MASK;
+	}
+	if (name == "elev")
+	{
+		return ZTreeMgr::LAYER_ELEV;
+	}
+	return ZTreeMgr::LAYER_SURF;
+}
+
+//! Compares buffered and unbuffered tile archive read throughput.
+//! The first buffered pass reads from disk only if the archive is not already in the OS page cache, e.g. after a reboot.
+//! The second buffered pass reads from the page cache. Unbuffered passes always read from disk.
+//! Usage: TileArchiveReadBenchmark <planet texture directory> [surf|mask|elev] [node count] [unbuffered threads]
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: TileArchiveReadBenchmark <planet texture directory> [surf|mask|elev] [node count] [unbuffered threads]" << std::endl;
+		return 1;
+	}
+
+	ZTreeMgr treeMgr(argv[1], parseLayer((argc > 2) ? argv[2] : "surf"));
+	std::size_t nodeCount = (argc > 3) ? std::stoul(argv[3]) : 2000;
+	int threadCount = (argc > 4) ? std::max(1, std::stoi(argv[4])) : 4;
+
+	std::vector<DWORD> nodes = sampleNodes(treeMgr, nodeCount);
+	if (nodes.empty())
+	{
+		std::cerr << "No tiles found in archive '" << treeMgr.ArchiveName() << "'" << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<UnbufferedFile> unbufferedFile = UnbufferedFile::open(treeMgr.ArchiveName());
+	if (!unbufferedFile)
+	{
+		std::cerr << "Could not open archive '" << treeMgr.ArchiveName() << "' for unbuffered reading" << std::endl;
+		return 1;
+	}
+
+	std::cout << "Reading " << nodes.size() << " tiles from '" << treeMgr.ArchiveName() << "'" << std::endl;
+	printResult("Buffered, first pass", readBuffered(treeMgr, nodes), nodes.size());
+	printResult("Buffered, page cache", readBuffered(treeMgr, nodes), nodes.size());
+	printResult("Unbuffered, 1 thread", readUnbuffered(*unbufferedFile, treeMgr, nodes, 1), nodes.size());
+	printResult("Unbuffered, " + std::to_string(threadCount) + " threads", readUnbuffered(*unbufferedFile, treeMgr, nodes, threadCount), nodes.size());
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/CompactElevationTile.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+static void checkRoundTrip(const std::vector<std::uint16_t>& texels, int width, int height, CompactElevationTile::Encoding expectedEncoding)
+{
+	ElevationTexelBounds bounds;
+	for (std::uint16_t texel : texels)
+	{
+		bounds.add(texel);
+	}
+
+	CompactElevationTile tile(texels.data(), width, height, bounds);
+	CHECK(tile.getEncoding() == expectedEncoding);
+	CHECK(tile.getWidth() == width);
+	CHECK(tile.getHeight() == height);
+
+	std::vector<std::uint16_t> decoded(texels.size());
+	tile.decode(decoded.data());
+	CHECK(decoded == texels);
+}
+
+TEST_CASE("Compact elevation tile round trips each encoding losslessly")
+{
+	constexpr int width = 257;
+	constexpr int height = 257;
+	std::vector<std::uint16_t> texels(width * height);
+	std::mt19937 rng(2);
+
+	SECTION("Constant")
+	{
+		std::fill(texels.begin(), texels.end(), std::uint16_t(32768));
+		checkRoundTrip(texels, width, height, CompactElevationTile::Encoding::Constant);
+	}
+
+	SECTION("Offset8")
+	{
+		std::generate(texels.begin(), texels.end(), [&] { return std::uint16_t(32768 + rng() % 256); });
+		checkRoundTrip(texels, width, height, CompactElevationTile::Encoding::Offset8);
+	}
+
+	SECTION("Delta8")
+	{
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				texels[y * width + x] = std::uint16_t(32768 + 2000 * std::sin(x * 0.05) * std::cos(y * 0.07) + rng() % 20);
+			}
+		}
+		checkRoundTrip(texels, width, height, CompactElevationTile::Encoding::Delta8);
+	}
+
+	SECTION("Raw16")
+	{
+		std::generate(texels.begin(), texels.end(), [&] { return std::uint16_t(rng()); });
+		checkRoundTrip(texels, width, height, CompactElevationTile::Encoding::Raw16);
+	}
+
+	SECTION("Extremes")
+	{
+		for (std::size_t i = 0; i < texels.size(); ++i)
+		{
+			texels[i] = (i % 2) ? 0 : 65535;
+		}
+		checkRoundTrip(texels, width, height, CompactElevationTile::Encoding::Raw16);
+	}
+}
+
+TEST_CASE("Compact elevation tile round trips a single row")
+{
+	// Padding texels are stored as a single row
+	std::vector<std::uint16_t> texels(1032);
+	for (std::size_t i = 0; i < texels.size(); ++i)
+	{
+		texels[i] = std::uint16_t(30000 + (i * 37) % 1000);
+	}
+	checkRoundTrip(texels, int(texels.size()), 1, CompactElevationTile::Encoding::Delta8);
+}
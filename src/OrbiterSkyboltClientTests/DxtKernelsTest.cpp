@@ -0,0 +1,275 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/DxtKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static std::vector<std::uint8_t> createRandomDxt1(std::mt19937& rng, int width, int height)
+{
+	std::vector<std::uint8_t> data(getDxt1ImageSizeBytes(width, height));
+	for (std::uint8_t& byte : data)
+	{
+		byte = std::uint8_t(rng());
+	}
+	return data;
+}
+
+//! @returns for each texel, the block's colors and the texel's index, which together identify the decoded color
+static std::vector<std::uint64_t> getTexelCodes(const std::vector<std::uint8_t>& data, int width, int height)
+{
+	std::vector<std::uint64_t> codes(width * height);
+	const int blockCountX = width / 4;
+	for (int by = 0; by < height / 4; ++by)
+	{
+		for (int bx = 0; bx < blockCountX; ++bx)
+		{
+			const std::uint8_t* block = data.data() + (by * blockCountX + bx) * dxt1BlockSizeBytes;
+			std::uint32_t colors;
+			std::memcpy(&colors, block, sizeof(colors));
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int column = 0; column < 4; ++column)
+				{
+					int index = (block[4 + row] >> (2 * column)) & 3;
+					codes[(by * 4 + row) * width + bx * 4 + column] = (std::uint64_t(colors) << 8) | index;
+				}
+			}
+		}
+	}
+	return codes;
+}
+
+TEST_CASE("Vectorized DXT1 vertical flip matches scalar output")
+{
+	std::mt19937 rng(3);
+
+	// Sizes cover block rows narrower than a vector and vector remainders
+	for (int width : {4, 8, 12, 16, 36, 160, 512})
+	{
+		for (int height : {4, 8, 12, 40, 512})
+		{
+			std::vector<std::uint8_t> source = createRandomDxt1(rng, width, height);
+			std::vector<std::uint8_t> expected = source;
+			std::vector<std::uint8_t> actual = source;
+			flipDxt1VerticalScalar(expected.data(), width, height);
+			flipDxt1Vertical(actual.data(), width, height);
+			CHECK(actual == expected);
+		}
+	}
+}
+
+TEST_CASE("DXT1 vertical flip moves each texel to the mirrored row")
+{
+	std::mt19937 rng(4);
+	const int width = 32;
+	const int height = 24;
+	std::vector<std::uint8_t> source = createRandomDxt1(rng, width, height);
+	std::vector<std::uint8_t> flipped = source;
+	flipDxt1Vertical(flipped.data(), width, height);
+
+	std::vector<std::uint64_t> sourceCodes = getTexelCodes(source, width, height);
+	std::vector<std::uint64_t> flippedCodes = getTexelCodes(flipped, width, height);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			REQUIRE(flippedCodes[y * width + x] == sourceCodes[(height - 1 - y) * width + x]);
+		}
+	}
+
+	// Flipping twice restores the original
+	flipDxt1Vertical(flipped.data(), width, height);
+	CHECK(flipped == source);
+}
+
+using Rgba = std::array<int, 4>;
+
+static Rgba decode565(int color)
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255};
+}
+
+//! Reference decoder for whole DXT1 images
+static std::vector<Rgba> decodeDxt1(const std::uint8_t* data, int width, int height)
+{
+	std::vector<Rgba> texels(width * height);
+	const int blockCountX = (width + 3) / 4;
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const std::uint8_t* block = data + ((y / 4) * blockCountX + x / 4) * dxt1BlockSizeBytes;
+			int c0 = block[0] | (block[1] << 8);
+			int c1 = block[2] | (block[3] << 8);
+			Rgba p0 = decode565(c0);
+			Rgba p1 = decode565(c1);
+			int index = (block[4 + y % 4] >> (2 * (x % 4))) & 3;
+
+			Rgba& texel = texels[y * width + x];
+			for (int c = 0; c < 3; ++c)
+			{
+				switch (index)
+				{
+					case 0: texel[c] = p0[c]; break;
+					case 1: texel[c] = p1[c]; break;
+					case 2: texel[c] = (c0 > c1) ? (2 * p0[c] + p1[c]) / 3 : (p0[c] + p1[c]) / 2; break;
+					case 3: texel[c] = (c0 > c1) ? (p0[c] + 2 * p1[c]) / 3 : 0; break;
+				}
+			}
+			texel[3] = (index == 3 && c0 <= c1) ? 0 : 255;
+		}
+	}
+	return texels;
+}
+
+static void setBlock(std::uint8_t* block, int color0, int color1, std::uint32_t indices)
+{
+	block[0] = std::uint8_t(color0);
+	block[1] = std::uint8_t(color0 >> 8);
+	block[2] = std::uint8_t(color1);
+	block[3] = std::uint8_t(color1 >> 8);
+	std::memcpy(block + 4, &indices, sizeof(indices));
+}
+
+TEST_CASE("DXT1 mip chain sizes")
+{
+	CHECK(getDxt1MipLevelCount(512, 512) == 10);
+	CHECK(getDxt1MipLevelCount(8, 2) == 4);
+	CHECK(getDxt1MipLevelCount(1, 1) == 1);
+
+	// Levels below 4x4 texels still take a whole block
+	CHECK(getDxt1MipChainSizeBytes(4, 4) == 3 * dxt1BlockSizeBytes);
+	CHECK(getDxt1MipChainSizeBytes(512, 512) == 131072 + 32768 + 8192 + 2048 + 512 + 128 + 32 + 3 * dxt1BlockSizeBytes);
+}
+
+TEST_CASE("DXT1 downsampling preserves uniform color")
+{
+	const int width = 16;
+	const int height = 8;
+	const int color = (20 << 11) | (40 << 5) | 10;
+	std::vector<std::uint8_t> source(getDxt1ImageSizeBytes(width, height));
+	for (std::size_t offset = 0; offset < source.size(); offset += dxt1BlockSizeBytes)
+	{
+		setBlock(source.data() + offset, color, color, 0);
+	}
+
+	std::vector<std::uint8_t> result(getDxt1ImageSizeBytes(width / 2, height / 2));
+	downsampleDxt1(source.data(), width, height, result.data());
+
+	Rgba expected = decode565(color);
+	for (const Rgba& texel : decodeDxt1(result.data(), width / 2, height / 2))
+	{
+		CHECK(texel == expected);
+	}
+}
+
+TEST_CASE("DXT1 downsampling produces opaque blocks")
+{
+	// Blocks with color0 <= color1 decode index 3 as transparent black
+	std::mt19937 rng(5);
+	const int width = 32;
+	const int height = 32;
+	std::vector<std::uint8_t> source(getDxt1ImageSizeBytes(width, height));
+	for (std::size_t offset = 0; offset < source.size(); offset += dxt1BlockSizeBytes)
+	{
+		int color0 = int(rng() & 0x7fff);
+		setBlock(source.data() + offset, color0, color0 + 1, std::uint32_t(rng()));
+	}
+
+	std::vector<std::uint8_t> result(getDxt1ImageSizeBytes(width / 2, height / 2));
+	downsampleDxt1(source.data(), width, height, result.data());
+
+	for (std::size_t offset = 0; offset < result.size(); offset += dxt1BlockSizeBytes)
+	{
+		CHECK(getDxt1BlockTransparencyMask(result.data() + offset) == 0);
+	}
+}
+
+TEST_CASE("DXT1 downsampling approximates a box filter of smooth content")
+{
+	std::mt19937 rng(6);
+	const int width = 128;
+	const int height = 128;
+
+	// Endpoints follow a smooth gradient, with random indices between them
+	auto encode565 = [](int r, int g, int b) {
+		return (std::clamp(r, 0, 31) << 11) | (std::clamp(g, 0, 63) << 5) | std::clamp(b, 0, 31);
+	};
+	std::vector<std::uint8_t> source(getDxt1ImageSizeBytes(width, height));
+	for (int by = 0; by < height / 4; ++by)
+	{
+		for (int bx = 0; bx < width / 4; ++bx)
+		{
+			double t = std::sin(bx * 0.08) * std::cos(by * 0.07);
+			int r = int(15 + 10 * t);
+			int g = int(32 + 20 * t);
+			int b = int(12 + 8 * t);
+			setBlock(source.data() + (by * (width / 4) + bx) * dxt1BlockSizeBytes, encode565(r + 1, g + 2, b + 1), encode565(r - 1, g - 2, b - 1), std::uint32_t(rng()));
+		}
+	}
+
+	const int dstWidth = width / 2;
+	const int dstHeight = height / 2;
+	std::vector<std::uint8_t> result(getDxt1ImageSizeBytes(dstWidth, dstHeight));
+	downsampleDxt1(source.data(), width, height, result.data());
+
+	std::vector<Rgba> sourceTexels = decodeDxt1(source.data(), width, height);
+	std::vector<Rgba> resultTexels = decodeDxt1(result.data(), dstWidth, dstHeight);
+	double squaredError = 0;
+	for (int y = 0; y < dstHeight; ++y)
+	{
+		for (int x = 0; x < dstWidth; ++x)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				double expected = (sourceTexels[(2 * y) * width + 2 * x][c] + sourceTexels[(2 * y) * width + 2 * x + 1][c]
+					+ sourceTexels[(2 * y + 1) * width + 2 * x][c] + sourceTexels[(2 * y + 1) * width + 2 * x + 1][c]) / 4.0;
+				double error = resultTexels[y * dstWidth + x][c] - expected;
+				squaredError += error * error;
+			}
+		}
+	}
+
+	double meanSquaredError = squaredError / (dstWidth * dstHeight * 3);
+	double psnr = 10 * std::log10(255.0 * 255.0 / std::max(meanSquaredError, 1e-6));
+	CHECK(psnr > 30);
+}
+
+TEST_CASE("DXT1 downsampling handles levels smaller than a block")
+{
+	std::mt19937 rng(7);
+	for (auto [width, height] : {std::pair(4, 4), std::pair(2, 2), std::pair(8, 4), std::pair(16, 1)})
+	{
+		std::vector<std::uint8_t> source = createRandomDxt1(rng, width, height);
+		int dstWidth = std::max(1, width / 2);
+		int dstHeight = std::max(1, height / 2);
+
+		// Guard bytes detect writes beyond the destination level
+		std::size_t dstSizeBytes = getDxt1ImageSizeBytes(dstWidth, dstHeight);
+		std::vector<std::uint8_t> result(dstSizeBytes + dxt1BlockSizeBytes, 0xcd);
+		downsampleDxt1(source.data(), width, height, result.data());
+
+		CHECK(std::all_of(result.begin() + dstSizeBytes, result.end(), [](std::uint8_t byte) { return byte == 0xcd; }));
+		CHECK(getDxt1BlockTransparencyMask(result.data()) == 0);
+	}
+}
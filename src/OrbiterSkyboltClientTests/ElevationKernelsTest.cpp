@@ -0,0 +1,136 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/ElevationKernels.h"
+
+#include <random>
+#include <vector>
+
+template <typename SourceT>
+static void checkBiasMatchesScalar(const std::vector<SourceT>& source, int offset, int count)
+{
+	std::vector<std::uint16_t> expected(count);
+	std::vector<std::uint16_t> actual(count);
+	ElevationTexelBounds expectedBounds;
+	ElevationTexelBounds actualBounds;
+
+	biasElevationRowScalar(source.data() + offset, expected.data(), count, expectedBounds);
+	biasElevationRow(source.data() + offset, actual.data(), count, actualBounds);
+
+	CHECK(actual == expected);
+	CHECK(actualBounds.min == expectedBounds.min);
+	CHECK(actualBounds.max == expectedBounds.max);
+}
+
+TEST_CASE("Vectorized elevation row bias matches scalar output")
+{
+	std::mt19937 rng(1);
+
+	// Counts cover empty rows, rows shorter than a vector, and vector remainders. Offsets cover unaligned sources.
+	for (int count : {0, 1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 257, 1000})
+	{
+		for (int offset = 0; offset < 3; ++offset)
+		{
+			std::vector<std::uint8_t> source8(count + offset);
+			std::vector<std::int16_t> source16(count + offset);
+			for (std::size_t i = 0; i < source8.size(); ++i)
+			{
+				source8[i] = std::uint8_t(rng());
+				source16[i] = std::int16_t(rng());
+			}
+
+			// Include the extremes of the int16 range
+			if (count >= 2)
+			{
+				source16[offset] = -32768;
+				source16[offset + 1] = 32767;
+			}
+
+			checkBiasMatchesScalar(source8, offset, count);
+			checkBiasMatchesScalar(source16, offset, count);
+		}
+	}
+}
+
+TEST_CASE("Elevation row bias of an empty row leaves bounds empty")
+{
+	std::vector<std::int16_t> source(1);
+	std::uint16_t out;
+	ElevationTexelBounds bounds;
+	biasElevationRow(source.data(), &out, 0, bounds);
+	CHECK(bounds.isEmpty());
+}
+
+TEST_CASE("Elevation row bias adds 32768 to texels")
+{
+	std::vector<std::int16_t> source16 = {-32768, -1, 0, 1, 32767};
+	std::vector<std::uint16_t> out(source16.size());
+	ElevationTexelBounds bounds;
+	biasElevationRow(source16.data(), out.data(), int(source16.size()), bounds);
+	CHECK(out == std::vector<std::uint16_t>({0, 32767, 32768, 32769, 65535}));
+	CHECK(bounds.min == 0);
+	CHECK(bounds.max == 65535);
+
+	std::vector<std::uint8_t> source8 = {0, 255};
+	bounds = ElevationTexelBounds();
+	biasElevationRow(source8.data(), out.data(), int(source8.size()), bounds);
+	CHECK(out[0] == 32768);
+	CHECK(out[1] == 33023);
+}
+
+TEST_CASE("Vectorized normal row matches scalar output")
+{
+	std::mt19937 rng(1);
+
+	// Counts cover rows shorter than a vector and vector remainders. Offsets cover unaligned rows.
+	for (int count : {0, 1, 3, 4, 5, 7, 8, 9, 16, 17, 257})
+	{
+		for (int offset = 0; offset < 3; ++offset)
+		{
+			std::vector<std::uint16_t> rows[3];
+			for (std::vector<std::uint16_t>& row : rows)
+			{
+				row.resize(offset + count + 2);
+				for (std::uint16_t& texel : row)
+				{
+					// Keep differences small enough for normals to cover the full range of slopes
+					texel = std::uint16_t(32768 + int(rng() % 201) - 100);
+				}
+			}
+
+			// Include vertical faces, which give the extreme normal components
+			if (count >= 1)
+			{
+				rows[1][offset] = 0;
+				rows[1][offset + 2] = 65535;
+			}
+
+			for (float scale : {0.01f, 1.0f, -3.0f})
+			{
+				std::vector<std::uint16_t> expected(count);
+				std::vector<std::uint16_t> actual(count);
+				computeNormalRowScalar(rows[0].data() + offset, rows[1].data() + offset, rows[2].data() + offset, count, scale, 0.5f * scale, expected.data());
+				computeNormalRow(rows[0].data() + offset, rows[1].data() + offset, rows[2].data() + offset, count, scale, 0.5f * scale, actual.data());
+				CHECK(actual == expected);
+			}
+		}
+	}
+}
+
+TEST_CASE("Normal of flat terrain points straight up")
+{
+	std::vector<std::uint16_t> row(10, 40000);
+	std::vector<std::uint16_t> out(8);
+	computeNormalRow(row.data(), row.data(), row.data(), 8, 1.0f, 1.0f, out.data());
+	CHECK(out == std::vector<std::uint16_t>(8, std::uint16_t(128 | (128 << 8))));
+}
@@ -0,0 +1,88 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/ElevationMinMaxPyramid.h"
+
+#include <random>
+#include <vector>
+
+static ElevationTexelBounds getExactBounds(const std::vector<std::uint16_t>& texels, int width, int minX, int minY, int maxX, int maxY)
+{
+	ElevationTexelBounds bounds;
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			bounds.add(texels[y * width + x]);
+		}
+	}
+	return bounds;
+}
+
+TEST_CASE("Elevation min/max pyramid bounds contain the texels they cover")
+{
+	std::mt19937 rng(3);
+
+	// Sizes cover a full tile, partial blocks and the smallest grid
+	for (int size : {257, 20, 9, 2})
+	{
+		std::vector<std::uint16_t> texels(size * size);
+		for (std::uint16_t& texel : texels)
+		{
+			texel = std::uint16_t(rng());
+		}
+		ElevationMinMaxPyramid pyramid(texels.data(), size, size);
+
+		ElevationTexelBounds exact = getExactBounds(texels, size, 0, 0, size - 1, size - 1);
+		CHECK(pyramid.getBounds().min == exact.min);
+		CHECK(pyramid.getBounds().max == exact.max);
+		CHECK(pyramid.getBlockCountX(pyramid.getLevelCount() - 1) == 1);
+		CHECK(pyramid.getBlockCountY(pyramid.getLevelCount() - 1) == 1);
+
+		for (int i = 0; i < 2000; ++i)
+		{
+			int x0 = rng() % size, x1 = rng() % size;
+			int y0 = rng() % size, y1 = rng() % size;
+			if (x0 > x1) std::swap(x0, x1);
+			if (y0 > y1) std::swap(y0, y1);
+
+			ElevationTexelBounds expected = getExactBounds(texels, size, x0, y0, x1, y1);
+			ElevationTexelBounds actual = pyramid.getBoundsInRect(x0, y0, x1, y1);
+			REQUIRE(actual.min <= expected.min);
+			REQUIRE(actual.max >= expected.max);
+		}
+	}
+}
+
+TEST_CASE("Uniform elevation min/max pyramid has the same layout as a computed pyramid")
+{
+	const int size = 257;
+	std::vector<std::uint16_t> texels(size * size, 1000);
+	ElevationTexelBounds bounds;
+	bounds.add(1000);
+
+	ElevationMinMaxPyramid computed(texels.data(), size, size);
+	ElevationMinMaxPyramid uniform(bounds, size, size);
+
+	REQUIRE(uniform.getLevelCount() == computed.getLevelCount());
+	for (int level = 0; level < uniform.getLevelCount(); ++level)
+	{
+		CHECK(uniform.getBlockCountX(level) == computed.getBlockCountX(level));
+		CHECK(uniform.getBlockCountY(level) == computed.getBlockCountY(level));
+		CHECK(uniform.getBounds(level, 0, 0).min == 1000);
+		CHECK(uniform.getBounds(level, 0, 0).max == 1000);
+	}
+	CHECK(uniform.getBounds().min == 1000);
+	CHECK(uniform.getBoundsInRect(3, 5, 100, 200).max == 1000);
+}
@@ -0,0 +1,126 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/FeaturePlacement.h"
+
+#include <algorithm>
+#include <cstring>
+
+static bool operator==(const FeatureInstance& a, const FeatureInstance& b)
+{
+	return std::memcmp(&a, &b, sizeof(FeatureInstance)) == 0;
+}
+
+static FeaturePlacementInputs createInputs(std::uint64_t tileId)
+{
+	FeaturePlacementInputs inputs;
+	inputs.tileId = tileId;
+	inputs.size = 1e-4;
+	inputs.southLatitude = 0.5;
+	return inputs;
+}
+
+//! @returns a flat sampler at the given elevation
+static ElevationSampler createFlatElevation(double elevation)
+{
+	ElevationSampler sampler{std::vector<std::uint16_t>(9 * 9, std::uint16_t(32768)), 9, 9, 1.0, elevation, AncestorMapping(), 10.0};
+	return sampler;
+}
+
+TEST_CASE("Feature placement is deterministic per tile")
+{
+	FeaturePlacementConfig config;
+	ElevationSampler elevation = createFlatElevation(100);
+
+	FeaturePlacementInputs inputs = createInputs(1234);
+	inputs.elevation = &elevation;
+
+	FeaturePlacementTilePtr first = placeFeatures(config, inputs);
+	FeaturePlacementTilePtr second = placeFeatures(config, inputs);
+	REQUIRE(!first->instances.empty());
+	CHECK(first->instances == second->instances);
+
+	FeaturePlacementTilePtr other = placeFeatures(config, createInputs(1235));
+	CHECK(!(other->instances == first->instances));
+}
+
+TEST_CASE("Feature placement fills cells at the configured density")
+{
+	FeaturePlacementConfig config;
+	config.cellsPerTileSide = 64;
+	config.density = 0.5;
+
+	FeaturePlacementTilePtr tile = placeFeatures(config, createInputs(1));
+	const double cellCount = 64 * 64;
+	CHECK(tile->instances.size() > 0.45 * cellCount);
+	CHECK(tile->instances.size() < 0.55 * cellCount);
+
+	for (const FeatureInstance& instance : tile->instances)
+	{
+		CHECK(instance.elevation == 0.0f); // Flat terrain without an elevation source
+		CHECK(instance.variant < config.variantCount);
+	}
+}
+
+TEST_CASE("Feature placement skips water")
+{
+	FeaturePlacementConfig config;
+	FeaturePlacementInputs inputs = createInputs(1);
+	FeaturePlacementTilePtr unmasked = placeFeatures(config, inputs);
+
+	LandMaskTile water = LandMaskTile::createUniform(8, 8, LandMaskTile::Coverage::Water);
+	inputs.landMask = &water;
+	CHECK(placeFeatures(config, inputs)->instances.empty());
+
+	LandMaskTile land = LandMaskTile::createUniform(8, 8, LandMaskTile::Coverage::Land);
+	inputs.landMask = &land;
+	CHECK(placeFeatures(config, inputs)->instances == unmasked->instances);
+}
+
+TEST_CASE("Feature placement skips terrain above the max elevation")
+{
+	FeaturePlacementConfig config;
+	config.maxElevation = 1000;
+	FeaturePlacementInputs inputs = createInputs(1);
+
+	ElevationSampler low = createFlatElevation(999);
+	inputs.elevation = &low;
+	FeaturePlacementTilePtr tile = placeFeatures(config, inputs);
+	REQUIRE(!tile->instances.empty());
+	CHECK(tile->instances.front().elevation == 999.0f);
+
+	ElevationSampler high = createFlatElevation(1001);
+	inputs.elevation = &high;
+	CHECK(placeFeatures(config, inputs)->instances.empty());
+}
+
+TEST_CASE("Feature placement skips steep terrain")
+{
+	FeaturePlacementConfig config;
+	config.maxSlope = 0.5;
+	FeaturePlacementInputs inputs = createInputs(1);
+
+	// Rows rise northwards by one meter per texel, which are ten meters apart
+	ElevationSampler gentle = createFlatElevation(0);
+	for (int y = 0; y < gentle.height; ++y)
+	{
+		std::fill_n(gentle.texels.begin() + y * gentle.width, gentle.width, std::uint16_t(32768 + y));
+	}
+	inputs.elevation = &gentle;
+	CHECK(!placeFeatures(config, inputs)->instances.empty());
+
+	ElevationSampler steep = gentle;
+	steep.scale = 10.0;
+	inputs.elevation = &steep;
+	CHECK(placeFeatures(config, inputs)->instances.empty());
+}
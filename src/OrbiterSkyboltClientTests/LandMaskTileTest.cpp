@@ -0,0 +1,92 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/DxtKernels.h"
+#include "TileSource/LandMaskTile.h"
+
+#include <random>
+#include <vector>
+
+//! Writes a DXT1 block in 3 color mode, where texels with index 3 are transparent
+static void writeBlock(std::uint8_t* block, std::uint32_t indices)
+{
+	// Color 0 <= color 1 selects 3 color mode with transparency
+	block[0] = 0x00; block[1] = 0x10;
+	block[2] = 0x00; block[3] = 0x20;
+	for (int row = 0; row < 4; ++row)
+	{
+		block[4 + row] = std::uint8_t(indices >> (row * 8));
+	}
+}
+
+static bool isTexelWater(const std::vector<std::uint8_t>& data, int width, int x, int y)
+{
+	const std::uint8_t* block = data.data() + ((y / 4) * (width / 4) + x / 4) * dxt1BlockSizeBytes;
+	return ((block[4 + y % 4] >> (2 * (x % 4))) & 3) == 3;
+}
+
+TEST_CASE("Land mask tile from uniform DXT1 data has uniform coverage")
+{
+	const int size = 16;
+	std::vector<std::uint8_t> data(getDxt1ImageSizeBytes(size, size));
+
+	for (std::size_t i = 0; i < data.size(); i += dxt1BlockSizeBytes)
+	{
+		writeBlock(data.data() + i, 0xFFFFFFFF);
+	}
+	LandMaskTile water = LandMaskTile::fromDxt1(data.data(), size, size);
+	CHECK(water.getCoverage() == LandMaskTile::Coverage::Water);
+	CHECK(water.isWater(5, 7));
+	CHECK(water.getSizeBytes() == sizeof(LandMaskTile));
+
+	for (std::size_t i = 0; i < data.size(); i += dxt1BlockSizeBytes)
+	{
+		writeBlock(data.data() + i, 0x00000000);
+	}
+	LandMaskTile land = LandMaskTile::fromDxt1(data.data(), size, size);
+	CHECK(land.getCoverage() == LandMaskTile::Coverage::Land);
+	CHECK(!land.isWater(5, 7));
+	CHECK(LandMaskTile::getDxt1Coverage(data.data(), size, size) == LandMaskTile::Coverage::Land);
+}
+
+TEST_CASE("Land mask tile from mixed DXT1 data matches decoded alpha")
+{
+	std::mt19937 rng(5);
+	const int width = 32;
+	const int height = 24;
+	std::vector<std::uint8_t> data(getDxt1ImageSizeBytes(width, height));
+	for (std::size_t i = 0; i < data.size(); i += dxt1BlockSizeBytes)
+	{
+		writeBlock(data.data() + i, std::uint32_t(rng()));
+	}
+
+	LandMaskTile tile = LandMaskTile::fromDxt1(data.data(), width, height);
+	REQUIRE(tile.getCoverage() == LandMaskTile::Coverage::Mixed);
+	CHECK(LandMaskTile::getDxt1Coverage(data.data(), width, height) == LandMaskTile::Coverage::Mixed);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			REQUIRE(tile.isWater(x, y) == isTexelWater(data, width, x, y));
+		}
+	}
+}
+
+TEST_CASE("Opaque DXT1 blocks are land")
+{
+	// Color 0 > color 1 selects 4 color mode, which has no transparency, even with index 3
+	std::uint8_t block[dxt1BlockSizeBytes] = {0x00, 0x20, 0x00, 0x10, 0xFF, 0xFF, 0xFF, 0xFF};
+	CHECK(getDxt1BlockTransparencyMask(block) == 0);
+	CHECK(LandMaskTile::getDxt1Coverage(block, 4, 4) == LandMaskTile::Coverage::Land);
+}
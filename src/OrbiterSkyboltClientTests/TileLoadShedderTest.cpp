@@ -0,0 +1,106 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/TileLoadShedder.h"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static TileLoadSheddingConfig createTestConfig()
+{
+	TileLoadSheddingConfig config;
+	config.maxInFlightRequests = 8;
+	config.maxLatencyMs = 10;
+	config.minLevelCap = 6;
+	config.capInterval = 0ms;
+	config.recoveryInterval = 0ms;
+	config.latencyHalfLife = 10ms;
+	return config;
+}
+
+static void runRequest(TileLoadShedder& shedder, int level, std::chrono::steady_clock::duration latency)
+{
+	shedder.requestStarted(level);
+	shedder.requestFinished(latency);
+}
+
+TEST_CASE("Tile load shedder leaves fast requests uncapped")
+{
+	TileLoadShedder shedder(createTestConfig());
+	for (int i = 0; i < 100; ++i)
+	{
+		runRequest(shedder, 12, 1ms);
+	}
+	CHECK(!shedder.getLevelCap());
+}
+
+TEST_CASE("Tile load shedder lowers the cap by one level per interval")
+{
+	TileLoadSheddingConfig config = createTestConfig();
+	config.capInterval = 1h;
+	TileLoadShedder shedder(config);
+
+	for (int i = 0; i < 5; ++i)
+	{
+		runRequest(shedder, 12, 1000ms);
+	}
+	CHECK(shedder.getLevelCap() == 11);
+}
+
+TEST_CASE("Tile load shedder does not cap below the min level")
+{
+	TileLoadShedder shedder(createTestConfig());
+	for (int i = 0; i < 20; ++i)
+	{
+		runRequest(shedder, 12, 1000ms);
+	}
+	CHECK(shedder.getLevelCap() == 6);
+}
+
+TEST_CASE("Tile load shedder caps while too many requests are in flight")
+{
+	TileLoadSheddingConfig config = createTestConfig();
+	config.capInterval = 1h;
+	TileLoadShedder shedder(config);
+	for (int i = 0; i < 10; ++i)
+	{
+		shedder.requestStarted(12);
+	}
+	runRequest(shedder, 12, 0ms);
+	CHECK(shedder.getInFlightRequestCount() == 10);
+	CHECK(shedder.getLevelCap() == 11);
+}
+
+TEST_CASE("Tile load shedder lifts the cap once requests stop")
+{
+	TileLoadShedder shedder(createTestConfig());
+	for (int i = 0; i < 3; ++i)
+	{
+		runRequest(shedder, 12, 1000ms);
+	}
+	std::optional<int> previousCap = shedder.getLevelCap();
+	REQUIRE(previousCap);
+
+	// With no requests finishing, the latency average decays and the cap is raised by availability queries alone
+	std::this_thread::sleep_for(200ms);
+	CHECK(shedder.getRecentLatencyMs() < 1);
+
+	for (int i = 0; i < 10 && previousCap; ++i)
+	{
+		std::optional<int> cap = shedder.getLevelCap();
+		CHECK((!cap || *cap == *previousCap + 1));
+		previousCap = cap;
+	}
+	CHECK(!previousCap);
+}
@@ -0,0 +1,127 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/TileWorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static bool waitFor(const std::atomic<int>& counter, int expected)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (counter < expected)
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+TEST_CASE("Tile worker pool runs tasks submitted from many threads")
+{
+	TileWorkerPool pool(4);
+	std::atomic<int> completedCount = 0;
+
+	constexpr int callerCount = 8;
+	constexpr int tasksPerCaller = 1000;
+	std::vector<std::thread> callers;
+	for (int i = 0; i < callerCount; ++i)
+	{
+		callers.emplace_back([&] {
+			for (int j = 0; j < tasksPerCaller; ++j)
+			{
+				pool.submit([&] { ++completedCount; });
+			}
+		});
+	}
+	for (std::thread& caller : callers)
+	{
+		caller.join();
+	}
+
+	CHECK(waitFor(completedCount, callerCount * tasksPerCaller));
+}
+
+TEST_CASE("Tile worker pool runs tasks submitted from its own threads")
+{
+	TileWorkerPool pool(2);
+	std::atomic<int> completedCount = 0;
+	std::atomic<bool> submittedFromPoolThread = true;
+
+	constexpr int parentCount = 100;
+	constexpr int childrenPerParent = 10;
+	for (int i = 0; i < parentCount; ++i)
+	{
+		pool.submit([&] {
+			submittedFromPoolThread = submittedFromPoolThread && pool.isPoolThread();
+			for (int j = 0; j < childrenPerParent; ++j)
+			{
+				pool.submit([&] { ++completedCount; });
+			}
+			++completedCount;
+		});
+	}
+
+	CHECK(waitFor(completedCount, parentCount * (childrenPerParent + 1)));
+	CHECK(submittedFromPoolThread);
+	CHECK(!pool.isPoolThread());
+}
+
+TEST_CASE("Tile worker pool discards queued tasks on destruction")
+{
+	std::atomic<int> completedCount = 0;
+	{
+		TileWorkerPool pool(1);
+		for (int i = 0; i < 1000; ++i)
+		{
+			pool.submit([&] {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				++completedCount;
+			});
+		}
+	}
+	CHECK(completedCount < 1000);
+}
+
+TEST_CASE("Tile worker pool splits items into contiguous task ranges")
+{
+	TileWorkerPool pool(2);
+
+	CHECK(pool.splitIntoTaskRanges(0, 256).empty());
+
+	for (std::uint32_t itemCount : {1u, 255u, 256u, 257u, 100000u})
+	{
+		std::vector<TileWorkerPool::IndexRange> ranges = pool.splitIntoTaskRanges(itemCount, 256);
+		REQUIRE(!ranges.empty());
+		CHECK(ranges.front().begin == 0);
+		CHECK(ranges.back().end == itemCount);
+		for (std::size_t i = 0; i < ranges.size(); ++i)
+		{
+			CHECK(ranges[i].begin < ranges[i].end);
+			if (i + 1 < ranges.size())
+			{
+				CHECK(ranges[i].end == ranges[i + 1].begin);
+				CHECK(ranges[i].end - ranges[i].begin >= 256);
+			}
+		}
+	}
+
+	// Large jobs are split into several tasks per thread
+	CHECK(pool.splitIntoTaskRanges(100000, 256).size() >= 8);
+}
@@ -0,0 +1,141 @@
+/*
+Copyright 2021 Matthew Reid
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <catch2/catch.hpp>
+
+#include "TileSource/TreeArchiveChecks.h"
+#include "TileSource/TreeArchiveValidator.h"
+
+#include <map>
+
+namespace {
+
+struct TestNode
+{
+	std::int64_t pos;
+	std::uint32_t size;
+	std::uint32_t child[4] = {noTreeNode, noTreeNode, noTreeNode, noTreeNode};
+};
+
+//! In-memory table of contents with the interface of ZTreeMgr's TreeTOC
+struct TestToc
+{
+	std::vector<TestNode> nodes;
+
+	std::uint32_t size() const { return std::uint32_t(nodes.size()); }
+	const TestNode& operator[](std::uint32_t idx) const { return nodes[idx]; }
+	std::uint32_t NodeSizeInflated(std::uint32_t idx) const { return nodes[idx].size; }
+};
+
+//! A root with two children, each with 10 bytes of data
+TestToc createValidToc()
+{
+	TestToc toc;
+	toc.nodes = {{0, 100}, {10, 100}, {20, 100}};
+	toc.nodes[0].child[0] = 1;
+	toc.nodes[0].child[3] = 2;
+	return toc;
+}
+
+const TreeDataLimits validLimits = {30, std::int64_t(30)};
+
+} // namespace
+
+TEST_CASE("Tree structure check accepts a valid archive")
+{
+	std::map<std::uint32_t, std::string> badNodes;
+	checkTreeStructure(createValidToc(), {0}, validLimits, [&](std::uint32_t idx, const std::string& reason) { badNodes[idx] = reason; });
+	CHECK(badNodes.empty());
+}
+
+TEST_CASE("Tree structure check reports bad references and block bounds")
+{
+	TestToc toc = createValidToc();
+	toc.nodes.push_back({25, 100});
+	toc.nodes[1].child[0] = 2; // second parent of node 2
+	// Node 3 extends to the end of the data block, which is beyond the end of the truncated file
+
+	TreeDataLimits limits = {30, std::int64_t(28)};
+	std::map<std::uint32_t, std::string> badNodes;
+	checkTreeStructure(toc, {0}, limits, [&](std::uint32_t idx, const std::string& reason) { badNodes[idx] = reason; });
+
+	CHECK(badNodes.size() == 2);
+	CHECK(badNodes[2] == "node referenced by more than one parent");
+	CHECK(badNodes[3] == "data extends beyond end of file");
+
+	// Out of range children are reported against the referencing node
+	std::map<std::uint32_t, std::string> outOfRangeNodes;
+	toc.nodes[1].child[0] = noTreeNode;
+	toc.nodes[2].child[1] = 7;
+	checkTreeStructure(toc, {0}, validLimits, [&](std::uint32_t idx, const std::string& reason) { outOfRangeNodes[idx] = reason; });
+	CHECK(outOfRangeNodes.size() == 1);
+	CHECK(outOfRangeNodes[2] == "child index out of range");
+}
+
+TEST_CASE("Tree structure check reports inconsistent data offsets")
+{
+	TestToc toc = createValidToc();
+	toc.nodes[2].pos = 5; // before the previous node's data
+
+	std::map<std::uint32_t, std::string> badNodes;
+	checkTreeStructure(toc, {0}, validLimits, [&](std::uint32_t idx, const std::string& reason) { badNodes[idx] = reason; });
+	CHECK(badNodes.size() == 1);
+	CHECK(badNodes[1] == "data size inconsistent with next node");
+}
+
+TEST_CASE("Tree block check marks nodes which fail to read or inflate as bad")
+{
+	TestToc toc = createValidToc();
+
+	auto read = [](std::int64_t offset, std::uint32_t sizeBytes, std::uint8_t* out) {
+		return offset != 10; // node 1 can't be read
+	};
+	auto inflate = [](const std::uint8_t* data, std::uint32_t sizeBytes, std::uint8_t* out, std::uint32_t outSizeBytes) {
+		return (sizeBytes == 10 && out) ? outSizeBytes : 0;
+	};
+
+	BadTreeNodes badNodes;
+	std::map<std::uint32_t, std::string> reasons;
+	auto addBadNode = [&](std::uint32_t idx, const std::string& reason) {
+		badNodes.insert(idx);
+		reasons[idx] = reason;
+	};
+
+	CHECK(checkTreeBlocks(toc, 0, toc.size(), validLimits, read, inflate, addBadNode) == 3);
+	CHECK(!badNodes.contains(0));
+	CHECK(badNodes.contains(1));
+	CHECK(!badNodes.contains(2));
+	CHECK(reasons[1] == "read failed");
+
+	// Node 2 now spans 15 bytes, but inflates to the wrong size
+	toc.nodes.push_back({35, 100});
+	TreeDataLimits limits = {40, std::int64_t(40)};
+	reasons.clear();
+	checkTreeBlocks(toc, 2, 3, limits, read, inflate, addBadNode);
+	CHECK(badNodes.contains(2));
+	CHECK(reasons[2] == "inflate failed");
+}
+
+TEST_CASE("Tree block check skips empty nodes and nodes with inconsistent bounds")
+{
+	TestToc toc = createValidToc();
+	toc.nodes[1].size = 0;
+	toc.nodes[2].pos = 50;
+
+	int readCount = 0;
+	auto read = [&](std::int64_t, std::uint32_t, std::uint8_t*) { ++readCount; return true; };
+	auto inflate = [](const std::uint8_t*, std::uint32_t, std::uint8_t*, std::uint32_t outSizeBytes) { return outSizeBytes; };
+
+	std::map<std::uint32_t, std::string> badNodes;
+	CHECK(checkTreeBlocks(toc, 0, toc.size(), validLimits, read, inflate, [&](std::uint32_t idx, const std::string& reason) { badNodes[idx] = reason; }) == 1);
+	CHECK(readCount == 1);
+	CHECK(badNodes.empty());
+}